@@ -24,10 +24,221 @@ SOFTWARE.
 
 #pragma once
 
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <memory_resource>
+#include <string>
+#include <string_view>
+
 namespace css_parser
 {
 // https://www.w3.org/TR/css-syntax-3/#input-byte-stream
-// The stream is expected to be UTF-8 encoded.
-// todo: encodings
-bool Parse(const char* text, unsigned size);
+// The stream is expected to be UTF-8 encoded, unless it starts with a UTF-16BE or UTF-16LE BOM.
+// Inputs of more than 2^30 - 1 code units are rejected, the offsets of token values are 32-bit.
+bool Parse(const char* text, std::size_t size);
+// Like Parse, but the input preprocessing of UTF-8 input is done in text itself instead of while tokenizing,
+// which leaves text changed. It costs a single vectorized scan when there is nothing to preprocess.
+bool ParseInPlace(char* text, std::size_t size);
+// Parses the stylesheet at path, a UTF-8 encoded file path, which is mapped into memory and tokenized
+// from there instead of being read into a buffer. Files that cannot be mapped, like pipes and the ones in /proc,
+// are read into a buffer instead. Returns false if the file cannot be opened or read, or is a directory.
+bool ParseFile(const char* path);
+
+// https://www.w3.org/TR/css-syntax-3/#tokenization
+enum class TokenKind : unsigned char
+{
+	Ident,
+	Function,
+	AtKeyword,
+	Hash,
+	String,
+	BadString,
+	URL,
+	BadURL,
+	Delim,
+	Number,
+	Percentage,
+	Dimension,
+	Whitespace,
+	CDO,
+	CDC,
+	Colon,
+	SemiColon,
+	Comma,
+	LeftSquareBracket,
+	RightSquareBracket,
+	LeftParenthesis,
+	RightParenthesis,
+	LeftCurlyBracket,
+	RightCurlyBracket
+};
+
+// https://www.w3.org/TR/css-syntax-3/#parsing
+enum class RuleKind : unsigned char
+{
+	Qualified,
+	At,
+	// https://www.w3.org/TR/css-nesting-1/#nested-declarations-rule
+	// The declarations of a block that follow one of its nested rules. It has no prelude and no block.
+	NestedDeclarations
+};
+
+// https://www.w3.org/TR/css-syntax-3/#component-value
+enum class ComponentValueKind : unsigned char
+{
+	PreservedToken,
+	Function,
+	SimpleBlock
+};
+
+// The tokens of a stylesheet, together with the storage of their values and the stylesheet itself,
+// which the values refer to. Moving a result moves a pointer, nothing is copied.
+// Tokens are accessed by index, from 0 to GetTokenCount(), the accessors of the values expect tokens of the kinds
+// that have them.
+// The rules of the stylesheet are parsed from the tokens the first time they are asked for, and the contents of each
+// block, prelude and declaration value the first time they are asked for, so only what is looked at is parsed.
+// Rules, declarations and component values are accessed by index too, and the children of each are a Range of
+// consecutive indices.
+// Since even the const accessors can parse, a result must not be accessed from several threads at once.
+// A moved-from result is empty: it is not valid, and has no tokens and no rules, so it has no index to access.
+class ParseResult
+{
+public:
+	constexpr static std::size_t NO_PARTNER = ~std::size_t(0);
+
+	ParseResult();
+	~ParseResult();
+	ParseResult(ParseResult&& other) noexcept;
+	ParseResult& operator=(ParseResult&& other) noexcept;
+	ParseResult(const ParseResult&) = delete;
+	ParseResult& operator=(const ParseResult&) = delete;
+
+	// False if tokenizing stopped on a parse error, the tokens before it are kept.
+	bool IsValid() const;
+	std::size_t GetTokenCount() const;
+	TokenKind GetKind(std::size_t index) const;
+	// The UTF-8 value of an ident, function, at-keyword, hash, string or url token. It stays valid as long as the result.
+	std::string_view GetValue(std::size_t index) const;
+	// Whether a hash token has the "id" type flag.
+	bool IsID(std::size_t index) const;
+	char32_t GetDelim(std::size_t index) const;
+	// The value of a number, percentage or dimension token, which is an integer if its type flag is "integer".
+	bool IsInteger(std::size_t index) const;
+	std::int64_t GetInteger(std::size_t index) const;
+	double GetNumber(std::size_t index) const;
+	// The UTF-8 unit of a dimension token.
+	std::string_view GetUnit(std::size_t index) const;
+	// The index of the token that closes the block or function a (, [, { or function token starts, or of the token
+	// a ), ] or } token closes, so that blocks are skipped without walking their contents.
+	// NO_PARTNER for blocks not closed before EOF and closing tokens that close nothing.
+	std::size_t GetPartner(std::size_t index) const;
+
+	// Indices from m_Begin to before m_End.
+	struct Range
+	{
+		std::size_t m_Begin = 0;
+		std::size_t m_End = 0;
+	};
+	// https://www.w3.org/TR/css-syntax-3/#parse-stylesheet
+	// The rules of the stylesheet itself. The other accessors of the stylesheet take the indices that this and the
+	// Range results of the others give, they do not need this to be called first.
+	Range GetRules();
+	RuleKind GetRuleKind(std::size_t rule) const;
+	// The UTF-8 name of an at-rule.
+	std::string_view GetRuleName(std::size_t rule) const;
+	// Whether an at-rule has a {} block, the ones that do not end with a semicolon. Qualified rules always have one.
+	bool HasBlock(std::size_t rule) const;
+	// The component values of the prelude of a rule, e.g. the selectors of a style rule.
+	Range GetPrelude(std::size_t rule);
+	// The declarations and the nested rules of the block of a rule. The declarations that follow a nested rule are
+	// in nested declarations rules among the nested rules.
+	Range GetDeclarations(std::size_t rule);
+	Range GetChildRules(std::size_t rule);
+	// The UTF-8 name of a declaration.
+	std::string_view GetDeclarationName(std::size_t declaration) const;
+	// The component values of the value of a declaration, without the whitespace around it and without !important.
+	Range GetDeclarationValue(std::size_t declaration);
+	bool IsImportant(std::size_t declaration) const;
+	ComponentValueKind GetComponentValueKind(std::size_t value) const;
+	// The index of the preserved token, of the function token of a function or of the opening token of a simple block.
+	std::size_t GetComponentValueToken(std::size_t value) const;
+	// The component values of the arguments of a function or of the contents of a simple block.
+	Range GetComponentValueChildren(std::size_t value) const;
+private:
+	friend ParseResult Tokenize(std::string source);
+	friend ParseResult TokenizeFile(const char* path);
+	friend class IncrementalTokenizer;
+	struct Data;
+	std::unique_ptr<Data> m_Data;
+};
+
+// Tokenizes a stylesheet, encoded like for Parse, into a result that owns it, so move source in to avoid a copy.
+ParseResult Tokenize(std::string source);
+// Tokenizes the stylesheet at path, which stays mapped into memory, or read into a buffer like for ParseFile,
+// as long as the result. The result is not valid if the file cannot be opened or read, or is a directory.
+ParseResult TokenizeFile(const char* path);
+
+// Tokenizes a stylesheet that arrives in chunks, e.g. from a socket, encoded like for Parse. A chunk can end anywhere,
+// even inside a code point, and the tokens are appended to a ParseResult as soon as they are complete, so they can be
+// looked at before the rest of the stylesheet has arrived. Only the code points of the token in progress are kept
+// between chunks, the values of the tokens are copied into the result.
+class IncrementalTokenizer
+{
+public:
+	explicit IncrementalTokenizer(std::pmr::memory_resource* resource = std::pmr::get_default_resource());
+	~IncrementalTokenizer();
+	IncrementalTokenizer(const IncrementalTokenizer&) = delete;
+	IncrementalTokenizer& operator=(const IncrementalTokenizer&) = delete;
+
+	// Appends the tokens that chunk completes to result, which has to be the same for all the chunks of a stylesheet
+	// and to start out as a default-constructed one. Appending tokens can move the values result returned before,
+	// and the partners of the blocks still open are only known after Finish.
+	// Returns false on a parse error, or when the stylesheet outgrows the offsets of token values, after which the
+	// rest of it is not tokenized.
+	bool Feed(const char* chunk, std::size_t size, ParseResult& result);
+	// Ends the stylesheet and appends its remaining tokens to result, which is then valid unless tokenizing stopped
+	// on an error. The rules of result are only to be asked for after this.
+	// The tokenizer then starts over, so the next chunk fed is the start of another stylesheet.
+	bool Finish(ParseResult& result);
+private:
+	struct State;
+	std::unique_ptr<State> m_State;
+};
+
+// Keeps the memory used to parse a stylesheet, i.e. the decoded code points, the tokens and their values,
+// for the next ones, so that parsing stops allocating once it has grown to fit the stylesheets parsed with it.
+// A context is meant to be reused by a single thread, e.g. for the many small stylesheets of a page.
+// Its buffers take their memory from resource, which has to outlive it, e.g. a pool local to the thread's NUMA node.
+class ParserContext
+{
+public:
+	explicit ParserContext(std::pmr::memory_resource* resource = std::pmr::get_default_resource());
+	~ParserContext();
+	ParserContext(const ParserContext&) = delete;
+	ParserContext& operator=(const ParserContext&) = delete;
+
+	// Like the free functions of the same names.
+	bool Parse(const char* text, std::size_t size);
+	bool ParseInPlace(char* text, std::size_t size);
+private:
+	struct Buffers;
+	std::unique_ptr<Buffers> m_Buffers;
+};
+
+// The instruction sets the tokenizer and decoder kernels have variants for, each including the ones before it.
+enum class InstructionSet
+{
+	Scalar,
+	SSE2,
+	AVX2,
+	AVX512,
+};
+
+// Returns the instruction set of the kernels in use, by default the widest one the CPU supports.
+InstructionSet GetInstructionSet();
+// Forces the kernels of instructionSet, e.g. to compare the variants on a single host.
+// Returns false and changes nothing if the CPU does not support instructionSet.
+// Must not be called while parsing on other threads.
+bool SetInstructionSet(InstructionSet instructionSet);
 }
\ No newline at end of file
@@ -24,14 +24,519 @@ SOFTWARE.
 
 #include "CSSParser/CSSParser.h"
 
-#include <string>
+#include <cstdint>
 #include <iostream>
+#include <iterator>
+#include <limits>
+#include <sstream>
+#include <string>
+#include <utility>
+
+namespace
+{
+bool Check(bool condition, const char* message)
+{
+	if (!condition)
+	{
+		std::cerr << message << '\n';
+	}
+	return condition;
+}
+
+std::string SerializeToken(const css_parser::ParseResult& result, std::size_t token)
+{
+	switch (result.GetKind(token))
+	{
+	case css_parser::TokenKind::Ident:
+		return std::string(result.GetValue(token));
+	case css_parser::TokenKind::Delim:
+		return std::string(1, static_cast<char>(result.GetDelim(token)));
+	case css_parser::TokenKind::Number:
+		return std::to_string(result.GetInteger(token));
+	case css_parser::TokenKind::Whitespace:
+		return " ";
+	case css_parser::TokenKind::Colon:
+		return ":";
+	case css_parser::TokenKind::SemiColon:
+		return ";";
+	case css_parser::TokenKind::Comma:
+		return ",";
+	case css_parser::TokenKind::RightSquareBracket:
+		return "]";
+	case css_parser::TokenKind::RightParenthesis:
+		return ")";
+	case css_parser::TokenKind::RightCurlyBracket:
+		return "}";
+	default:
+		return "?";
+	}
+}
+
+std::string SerializeComponentValues(const css_parser::ParseResult& result, css_parser::ParseResult::Range values)
+{
+	std::string output;
+	for (std::size_t value = values.m_Begin; value < values.m_End; ++value)
+	{
+		const std::size_t token = result.GetComponentValueToken(value);
+		const std::string children = SerializeComponentValues(result, result.GetComponentValueChildren(value));
+		switch (result.GetComponentValueKind(value))
+		{
+		case css_parser::ComponentValueKind::Function:
+			output += std::string(result.GetValue(token)) + "(" + children + ")";
+			break;
+		case css_parser::ComponentValueKind::SimpleBlock:
+			switch (result.GetKind(token))
+			{
+			case css_parser::TokenKind::LeftCurlyBracket:
+				output += "{" + children + "}";
+				break;
+			case css_parser::TokenKind::LeftSquareBracket:
+				output += "[" + children + "]";
+				break;
+			default:
+				output += "(" + children + ")";
+				break;
+			}
+			break;
+		default:
+			output += SerializeToken(result, token);
+			break;
+		}
+	}
+	return output;
+}
+
+// Writes the rules back with the whitespace around declarations dropped, the declarations ending with a semicolon,
+// and nested declarations rules as a block without a prelude.
+std::string SerializeRules(css_parser::ParseResult& result, css_parser::ParseResult::Range rules)
+{
+	std::string output;
+	for (std::size_t rule = rules.m_Begin; rule < rules.m_End; ++rule)
+	{
+		if (result.GetRuleKind(rule) == css_parser::RuleKind::At)
+		{
+			output += "@" + std::string(result.GetRuleName(rule));
+		}
+		output += SerializeComponentValues(result, result.GetPrelude(rule));
+		if (result.GetRuleKind(rule) == css_parser::RuleKind::At && !result.HasBlock(rule))
+		{
+			output += ";";
+			continue;
+		}
+		output += "{";
+		const css_parser::ParseResult::Range declarations = result.GetDeclarations(rule);
+		for (std::size_t declaration = declarations.m_Begin; declaration < declarations.m_End; ++declaration)
+		{
+			output += std::string(result.GetDeclarationName(declaration)) + ":"
+				+ SerializeComponentValues(result, result.GetDeclarationValue(declaration))
+				+ (result.IsImportant(declaration) ? "!important;" : ";");
+		}
+		output += SerializeRules(result, result.GetChildRules(rule)) + "}";
+	}
+	return output;
+}
+
+// The value of a number, percentage or dimension token.
+std::string DescribeNumericValue(const css_parser::ParseResult& result, std::size_t token)
+{
+	if (result.IsInteger(token))
+	{
+		return std::to_string(result.GetInteger(token));
+	}
+	std::ostringstream stream;
+	stream << result.GetNumber(token);
+	// A number whose value is integral is told apart from an integer by its fraction.
+	const std::string number = stream.str();
+	return number.find_first_of(".e") == std::string::npos ? number + ".0" : number;
+}
+
+std::string DescribeToken(const css_parser::ParseResult& result, std::size_t token)
+{
+	const std::string value = result.GetKind(token) <= css_parser::TokenKind::BadURL
+		|| result.GetKind(token) == css_parser::TokenKind::Dimension ? std::string(result.GetValue(token)) : std::string();
+	switch (result.GetKind(token))
+	{
+	case css_parser::TokenKind::Ident:
+		return "ident(" + value + ")";
+	case css_parser::TokenKind::Function:
+		return "function(" + value + ")";
+	case css_parser::TokenKind::AtKeyword:
+		return "at-keyword(" + value + ")";
+	case css_parser::TokenKind::Hash:
+		return (result.IsID(token) ? "id-hash(" : "hash(") + value + ")";
+	case css_parser::TokenKind::String:
+		return "string(" + value + ")";
+	case css_parser::TokenKind::BadString:
+		return "bad-string";
+	case css_parser::TokenKind::URL:
+		return "url(" + value + ")";
+	case css_parser::TokenKind::BadURL:
+		return "bad-url";
+	case css_parser::TokenKind::Delim:
+		return "delim(" + std::string(1, static_cast<char>(result.GetDelim(token))) + ")";
+	case css_parser::TokenKind::Number:
+		return "number(" + DescribeNumericValue(result, token) + ")";
+	case css_parser::TokenKind::Percentage:
+		return "percentage(" + DescribeNumericValue(result, token) + ")";
+	case css_parser::TokenKind::Dimension:
+		return "dimension(" + DescribeNumericValue(result, token) + " " + value + ")";
+	case css_parser::TokenKind::Whitespace:
+		return "whitespace";
+	case css_parser::TokenKind::CDO:
+		return "<!--";
+	case css_parser::TokenKind::CDC:
+		return "-->";
+	case css_parser::TokenKind::LeftSquareBracket:
+		return "[";
+	case css_parser::TokenKind::LeftParenthesis:
+		return "(";
+	case css_parser::TokenKind::LeftCurlyBracket:
+		return "{";
+	default:
+		return SerializeToken(result, token);
+	}
+}
+
+// Describes the tokens of result with their kinds and values, e.g. "ident(a) whitespace number(1)".
+std::string DescribeTokens(const css_parser::ParseResult& result)
+{
+	std::string output;
+	for (std::size_t token = 0; token < result.GetTokenCount(); ++token)
+	{
+		output += (token == 0 ? "" : " ") + DescribeToken(result, token);
+	}
+	return output;
+}
+
+// The description of the tokens, followed by the partner of each token that has one.
+std::string DescribeTokensAndPartners(const css_parser::ParseResult& result)
+{
+	std::string output = DescribeTokens(result) + " |";
+	for (std::size_t token = 0; token < result.GetTokenCount(); ++token)
+	{
+		const css_parser::TokenKind kind = result.GetKind(token);
+		if ((kind == css_parser::TokenKind::Function || kind >= css_parser::TokenKind::LeftSquareBracket)
+			&& result.GetPartner(token) != css_parser::ParseResult::NO_PARTNER)
+		{
+			output += " " + std::to_string(token) + ":" + std::to_string(result.GetPartner(token));
+		}
+	}
+	return output + (result.IsValid() ? "" : " invalid");
+}
+
+struct TokenizingCase
+{
+	std::string m_Input;
+	// The description of the tokens, see DescribeTokens, followed by " invalid" when tokenizing stops on an error.
+	const char* m_Tokens;
+};
+
+bool CheckTokenizing(const TokenizingCase& testCase)
+{
+	const css_parser::ParseResult result = css_parser::Tokenize(testCase.m_Input);
+	const std::string tokens = DescribeTokens(result) + (result.IsValid() ? "" : " invalid");
+	if (tokens != testCase.m_Tokens)
+	{
+		std::cerr << "Tokenizing " << testCase.m_Input << " gives " << tokens << " instead of " << testCase.m_Tokens << '\n';
+		return false;
+	}
+	return true;
+}
+
+bool CheckTokenizing(const TokenizingCase* begin, const TokenizingCase* end)
+{
+	bool isPassing = true;
+	for (const TokenizingCase* testCase = begin; testCase != end; ++testCase)
+	{
+		isPassing = CheckTokenizing(*testCase) && isPassing;
+	}
+	return isPassing;
+}
+
+// https://www.w3.org/TR/css-syntax-3/#tokenization
+bool CheckTokens()
+{
+	const TokenizingCase cases[] =
+	{
+		// Idents, units and hashes of fewer than three code points at the end of the input.
+		{"a", "ident(a)"},
+		{"-a", "ident(-a)"},
+		{"1px", "dimension(1 px)"},
+		{"1e", "dimension(1 e)"},
+		{"#a", "id-hash(a)"},
+		{"#1", "hash(1)"},
+		// At-keywords.
+		{"@media", "at-keyword(media)"},
+		{"@-x", "at-keyword(-x)"},
+		{"@1", "delim(@) number(1)"},
+		// The ( of a function token is consumed with its name.
+		{"f(a)", "function(f) ident(a) )"},
+		{"-f()", "function(-f) )"},
+		// https://www.w3.org/TR/css-syntax-3/#consume-ident-like-token
+		{"url(a)", "url(a)"},
+		{"url(\"a\")", "function(url) string(a) )"},
+		{"url(  'a')", "function(url) whitespace string(a) )"},
+		{"URL( b )", "url(b)"},
+		// The remnants of a bad url, up to its ), are part of it.
+		{"url(a b) c", "bad-url whitespace ident(c)"},
+		{"url(a\"b) c", "bad-url whitespace ident(c)"},
+		{"url(a\\)b) c", "url(a)b) whitespace ident(c)"},
+		{"[]", "[ ]"},
+		{"\\41 b", "ident(Ab)"},
+		{"\\\n", "delim(\\) whitespace"},
+		// Comments, one after the other, and a /*/ that does not close the comment it opens.
+		{"/* a *//* b */c", "ident(c)"},
+		{"/*/ a */b", "ident(b)"},
+		{"a /* b */", "ident(a) whitespace"},
+		{"/* a", " invalid"},
+		// https://www.w3.org/TR/css-syntax-3/#consume-escaped-code-point
+		{"\\30 x", "ident(0x)"},
+		{"\\0 x", "ident(\xEF\xBF\xBD" "x)"},
+		{"\\D800", "ident(\xEF\xBF\xBD)"},
+		{"\\110000", "ident(\xEF\xBF\xBD)"},
+		{"\\", "delim(\\)"},
+		// The end of the input in the middle of a token, and a newline in a string, are errors.
+		{"'a", " invalid"},
+		{"'a\\", " invalid"},
+		{"'a\nb'", " invalid"},
+		{"url(", " invalid"},
+		{"#", "delim(#)"},
+		{"-", "delim(-)"},
+		{"+.", "delim(+) delim(.)"},
+		{"<!--", "<!--"},
+		{"-->", "-->"},
+		// A UTF-8 BOM is removed, and a 2-byte input can be a UTF-16 BOM.
+		{"\xEF\xBB\xBF" "a", "ident(a)"},
+		{"\xFE\xFF", ""},
+		{"\xFF\xFE", ""},
+	};
+	return CheckTokenizing(std::begin(cases), std::end(cases));
+}
+
+// https://encoding.spec.whatwg.org/#shared-utf-16-decoder
+bool CheckUTF16()
+{
+	const TokenizingCase cases[] =
+	{
+		{std::string("\xFF\xFE" "a\0{\0}\0", 8), "ident(a) { }"},
+		{std::string("\xFE\xFF\0a\0{\0}", 8), "ident(a) { }"},
+		{std::string("\xFE\xFF\0a\0\xE9\x20\xAC", 8), "ident(a\xC3\xA9\xE2\x82\xAC)"},
+		// A surrogate pair, a lone leading surrogate, a lone trailing surrogate, and an odd byte at the end.
+		{std::string("\xFE\xFF\xD8\x3D\xDE\x00", 6), "ident(\xF0\x9F\x98\x80)"},
+		{std::string("\xFE\xFF\xD8\x3D\0a", 6), "ident(\xEF\xBF\xBD" "a)"},
+		{std::string("\xFE\xFF\xDE\x00\0a", 6), "ident(\xEF\xBF\xBD" "a)"},
+		{std::string("\xFE\xFF\0a\0", 5), "ident(a\xEF\xBF\xBD)"},
+		// The input preprocessing: CR LF is whitespace, and U+0000 NULL is replaced instead of ending the input.
+		{std::string("\xFF\xFE" "a\0\r\0\n\0", 8), "ident(a) whitespace"},
+		{std::string("\xFF\xFE" "a\0\0\0b\0", 8), "ident(a\xEF\xBF\xBD" "b)"},
+	};
+	return CheckTokenizing(std::begin(cases), std::end(cases));
+}
+
+struct NumberCase
+{
+	const char* m_Input;
+	bool m_IsInteger;
+	double m_Value;
+};
+
+// https://www.w3.org/TR/css-syntax-3/#convert-string-to-number
+// Non-integers are expected to be correctly rounded, like the double literals they are compared with.
+bool CheckNumbers()
+{
+	const NumberCase cases[] =
+	{
+		{"0", true, 0},
+		{"+12", true, 12},
+		{"-12", true, -12},
+		{"1.5", false, 1.5},
+		{".5", false, 0.5},
+		{"-.5e-3", false, -.5e-3},
+		{"1e3", false, 1e3},
+		{"1E+2", false, 1e2},
+		{"0.1", false, 0.1},
+		{"0.3", false, 0.3},
+		{"123456789.123456789", false, 123456789.123456789},
+		{"12e30", false, 12e30},
+		{"1.00000000000000011102230246251565404236316680908203125", false, 1.00000000000000011102230246251565404236316680908203125},
+		{"2.2250738585072014e-308", false, 2.2250738585072014e-308},
+		{"1.7976931348623157e308", false, 1.7976931348623157e308},
+		{"1e400", false, std::numeric_limits<double>::infinity()},
+		{"-1e400", false, -std::numeric_limits<double>::infinity()},
+		{"1e-400", false, 0},
+		{"50%", true, 50},
+		{"2.5em", false, 2.5},
+	};
+	bool isPassing = true;
+	for (const NumberCase& testCase : cases)
+	{
+		const css_parser::ParseResult result = css_parser::Tokenize(testCase.m_Input);
+		const bool isNumber = result.GetTokenCount() == 1 && result.IsInteger(0) == testCase.m_IsInteger
+			&& result.GetNumber(0) == testCase.m_Value;
+		if (!isNumber)
+		{
+			std::cerr << "Tokenizing " << testCase.m_Input << " gives " << DescribeTokens(result) << '\n';
+			isPassing = false;
+		}
+	}
+	// Integers are clamped to the range of std::int64_t.
+	const char* integers[] = {"9223372036854775807", "-9223372036854775808", "9223372036854775808", "-99999999999999999999"};
+	const std::int64_t values[] = {std::numeric_limits<std::int64_t>::max(), std::numeric_limits<std::int64_t>::min(),
+		std::numeric_limits<std::int64_t>::max(), std::numeric_limits<std::int64_t>::min()};
+	for (std::size_t i = 0; i < std::size(integers); ++i)
+	{
+		const css_parser::ParseResult result = css_parser::Tokenize(integers[i]);
+		isPassing = Check(result.GetTokenCount() == 1 && result.IsInteger(0) && result.GetInteger(0) == values[i],
+			"An integer out of the range of std::int64_t is not clamped") && isPassing;
+	}
+	return isPassing;
+}
+
+bool CheckStyleSheet(const char* text, const char* expected)
+{
+	css_parser::ParseResult result = css_parser::Tokenize(text);
+	const std::string rules = SerializeRules(result, result.GetRules());
+	if (rules != expected)
+	{
+		std::cerr << "Parsing " << text << " gives " << rules << " instead of " << expected << '\n';
+		return false;
+	}
+	return true;
+}
+
+// https://www.w3.org/TR/css-syntax-3/#parse-stylesheet
+bool CheckStyleSheets()
+{
+	bool isPassing = true;
+	// A } at the top level is part of the prelude of the rule it starts.
+	isPassing = CheckStyleSheet("} a{color:red}", "} a{color:red;}") && isPassing;
+	// A rule whose prelude starts like a custom property is dropped at the top level, and is a declaration in a block.
+	isPassing = CheckStyleSheet("--x:{a:b} b{c:d}", "b{c:d;}") && isPassing;
+	isPassing = CheckStyleSheet("a{--x:{b:c}; d:e}", "a{--x:{b:c};d:e;}") && isPassing;
+	isPassing = CheckStyleSheet("a{color:red !important; x: y ! IMPORTANT }", "a{color:red!important;x:y!important;}") && isPassing;
+	// The declarations after a nested rule are grouped in a nested declarations rule.
+	isPassing = CheckStyleSheet("a{color:red; b{c:d} e:f; g:h}", "a{color:red;b{c:d;}{e:f;g:h;}}") && isPassing;
+	css_parser::ParseResult result = css_parser::Tokenize("a{color:red; b{c:d} e:f}");
+	const css_parser::ParseResult::Range childRules = result.GetChildRules(result.GetRules().m_Begin);
+	isPassing = Check(childRules.m_End - childRules.m_Begin == 2
+		&& result.GetRuleKind(childRules.m_Begin) == css_parser::RuleKind::Qualified
+		&& result.GetRuleKind(childRules.m_Begin + 1) == css_parser::RuleKind::NestedDeclarations,
+		"The declarations after a nested rule are not in a nested declarations rule") && isPassing;
+	isPassing = CheckStyleSheet("@media x{a{b:c}} @import f(y) z;", "@media x{a{b:c;}}@import f(y) z;") && isPassing;
+	return isPassing;
+}
+
+// The const accessors of the stylesheet do not need the rules to have been asked for first.
+bool CheckStyleSheetConstAccess()
+{
+	css_parser::ParseResult result = css_parser::Tokenize("@x y; a{b:c}");
+	const css_parser::ParseResult& constResult = result;
+	bool isPassing = Check(constResult.GetRuleKind(0) == css_parser::RuleKind::At && constResult.GetRuleName(0) == "x"
+		&& !constResult.HasBlock(0) && constResult.GetRuleKind(1) == css_parser::RuleKind::Qualified,
+		"The const accessors of the rules give the wrong rules");
+	const css_parser::ParseResult::Range declarations = result.GetDeclarations(1);
+	isPassing = Check(declarations.m_End - declarations.m_Begin == 1
+		&& constResult.GetDeclarationName(declarations.m_Begin) == "b" && !constResult.IsImportant(declarations.m_Begin),
+		"The const accessors of the declarations give the wrong declarations") && isPassing;
+	return isPassing;
+}
+
+// A moved-from result is empty, and a result can be moved into it again.
+bool CheckMovedFromResult()
+{
+	css_parser::ParseResult result = css_parser::Tokenize("a{b:c}");
+	css_parser::ParseResult moved = std::move(result);
+	const css_parser::ParseResult::Range rules = result.GetRules();
+	bool isPassing = Check(!result.IsValid() && result.GetTokenCount() == 0 && rules.m_Begin == rules.m_End,
+		"A moved-from result is not empty");
+	isPassing = Check(moved.IsValid() && SerializeRules(moved, moved.GetRules()) == "a{b:c;}",
+		"A moved result does not keep the rules") && isPassing;
+	result = std::move(moved);
+	isPassing = Check(result.IsValid() && SerializeRules(result, result.GetRules()) == "a{b:c;}",
+		"A result moved into a moved-from one does not keep the rules") && isPassing;
+	return isPassing;
+}
+
+bool CheckIncrementalResult(const std::string& text, const css_parser::ParseResult& result, const std::string& expected,
+	const char* splitting)
+{
+	const std::string tokens = DescribeTokensAndPartners(result);
+	if (tokens != expected)
+	{
+		std::cerr << "Tokenizing " << text << " in " << splitting << " gives " << tokens << " instead of " << expected << '\n';
+		return false;
+	}
+	return true;
+}
+
+// Tokenizes text split into two chunks at every position and in chunks of one byte, which have to give the tokens
+// of the whole text. The same tokenizer is used for all of them, so it also checks that it starts over after Finish.
+bool CheckIncrementalTokenizing(css_parser::IncrementalTokenizer& tokenizer, const std::string& text)
+{
+	const std::string expected = DescribeTokensAndPartners(css_parser::Tokenize(text));
+	for (std::size_t split = 0; split <= text.size(); ++split)
+	{
+		css_parser::ParseResult result;
+		tokenizer.Feed(text.data(), split, result);
+		tokenizer.Feed(text.data() + split, text.size() - split, result);
+		tokenizer.Finish(result);
+		if (!CheckIncrementalResult(text, result, expected, ("two chunks split at " + std::to_string(split)).c_str()))
+		{
+			return false;
+		}
+	}
+	css_parser::ParseResult result;
+	for (const char& byte : text)
+	{
+		tokenizer.Feed(&byte, 1, result);
+	}
+	tokenizer.Finish(result);
+	return CheckIncrementalResult(text, result, expected, "chunks of one byte");
+}
+
+bool CheckIncrementalTokenizing()
+{
+	const std::string texts[] =
+	{
+		"a{color:red} /* comment */ b{}",
+		"/* a */ /**/ /*/ b */ c",
+		"'a\\'b' \"c\\\nd\" 'e\nf",
+		"url( a ) url(  'b' ) url(c d) url(e\\)f) -url(g)",
+		"1 -2.5 +.5e+3 4e 5% 6px -7-x 8\\41 #9 #-a #\\30",
+		"\\41 b \\\n c -\\42 --d _e \xC3\xA9 \xE2\x82\xAC\xF0\x9F\x98\x80 \xFF",
+		"<!-- --> @media ( [ ] ) ] f( { } } ( [",
+		"a\r\nb\rc\fd",
+		std::string("a b\0c d", 7),
+		"\xEF\xBB\xBF" "a{}",
+		std::string("\xFF\xFE" "a\0{\0b\0:\0" "1\0}\0", 14),
+		std::string("\xFE\xFF\0a\0 \0'\0b\0'\xD8\x3D\xDE\x00", 16),
+		"'" + std::string(1000, 'a') + "' /*" + std::string(1000, '*') + "*/ " + std::string(1000, 'b'),
+	};
+	css_parser::IncrementalTokenizer tokenizer;
+	bool isPassing = true;
+	for (const std::string& text : texts)
+	{
+		isPassing = CheckIncrementalTokenizing(tokenizer, text) && isPassing;
+	}
+	return isPassing;
+}
+}
 
 int main()
 {
+	bool isPassing = true;
 	std::string text("url(   \\t\\ABCD abc123   )");
 	if (!css_parser::Parse(text.c_str(), text.size()))
 	{
 		std::cerr << "Pasring error";
+		isPassing = false;
 	}
-}
\ No newline at end of file
+	isPassing = CheckTokens() && isPassing;
+	isPassing = CheckUTF16() && isPassing;
+	isPassing = CheckNumbers() && isPassing;
+	isPassing = CheckIncrementalTokenizing() && isPassing;
+	isPassing = CheckStyleSheets() && isPassing;
+	isPassing = CheckStyleSheetConstAccess() && isPassing;
+	isPassing = CheckMovedFromResult() && isPassing;
+	return isPassing ? 0 : 1;
+}
@@ -24,22 +24,399 @@ SOFTWARE.
 
 #include "CSSParser/CSSParser.h"
 #include "CodePoints.h"
+#include "MappedFile.h"
+#include "StyleSheet.h"
 #include "Tokens.h"
 
+#include <limits>
+#include <optional>
+
 namespace css_parser
 {
-bool Parse(const char* text, unsigned size)
+namespace
+{
+// Whether input is tokenized as UTF-8, i.e. does not start with a UTF-16 BOM. A UTF-8 BOM is removed by the tokenizer.
+bool IsUTF8(const char* text, SizeType size)
+{
+	const Encoding BOMEncoding = BOMSniff(StringView(text, size), 0);
+	return BOMEncoding == Encoding::Count || BOMEncoding == Encoding::UTF8;
+}
+
+// UTF-8 is tokenized directly, without a decoded copy of the input, and the tokens are not stored.
+bool ParseUTF8(Tokenizer& tokenizer)
 {
-	Vector<CodePoint> inputStream;
-	if (!CreateCodePointsStream(text, size, inputStream))
+	Token token;
+	do
+	{
+		if (!tokenizer.Next(token))
+		{
+			return false;
+		}
+	} while (token.GetType() != TokenType::EndOfFile);
+	return true;
+}
+
+bool ParseCodePoints(const char* text, SizeType size, CodePointBuffer& codePoints, TokenList& tokens)
+{
+	if (!CreateCodePointsStream(text, size, codePoints))
 	{
 		return false;
 	}
-	Vector<Token> tokens;
-	if (!TokenizeCodePoints(std::move(inputStream), tokens))
+	tokens.Clear();
+	return TokenizeCodePoints(codePoints, tokens);
+}
+}
+
+bool Parse(const char* text, std::size_t size)
+{
+	if (IsUTF8(text, size))
+	{
+		Tokenizer tokenizer(text, size);
+		return ParseUTF8(tokenizer);
+	}
+	CodePointBuffer codePoints;
+	TokenList tokens;
+	return ParseCodePoints(text, size, codePoints, tokens);
+}
+
+bool ParseInPlace(char* text, std::size_t size)
+{
+	if (!IsUTF8(text, size))
+	{
+		return Parse(text, size);
+	}
+	Tokenizer tokenizer(text, PreprocessUTF8InPlace(text, size));
+	return ParseUTF8(tokenizer);
+}
+
+bool ParseFile(const char* path)
+{
+	MappedFile file;
+	if (!file.Open(path))
 	{
 		return false;
 	}
-	return true;
+	return Parse(file.GetData(), file.GetSize());
+}
+
+struct ParseResult::Data
+{
+	StyleSheet& GetStyleSheet() const
+	{
+		if (!m_StyleSheet)
+		{
+			m_StyleSheet.emplace(m_Tokens);
+		}
+		return *m_StyleSheet;
+	}
+
+	// The source is either owned as a string or mapped from a file.
+	std::string m_Source;
+	MappedFile m_File;
+	TokenList m_Tokens;
+	bool m_IsValid = false;
+	// Created the first time anything of the stylesheet is asked for, which can be from a const accessor.
+	mutable std::optional<StyleSheet> m_StyleSheet;
+};
+
+namespace
+{
+bool TokenizeInto(const char* text, SizeType size, TokenList& tokens)
+{
+	if (IsUTF8(text, size))
+	{
+		return TokenizeUTF8(text, size, tokens);
+	}
+	// The values of decoded input are all stored in the payload, the code points are not needed afterwards.
+	CodePointBuffer codePoints;
+	return CreateCodePointsStream(text, size, codePoints) && TokenizeCodePoints(codePoints, tokens);
+}
+}
+
+ParseResult::ParseResult()
+	: m_Data(new Data())
+{
+}
+
+ParseResult::~ParseResult() = default;
+ParseResult::ParseResult(ParseResult&& other) noexcept = default;
+ParseResult& ParseResult::operator=(ParseResult&& other) noexcept = default;
+
+bool ParseResult::IsValid() const
+{
+	return m_Data && m_Data->m_IsValid;
+}
+
+std::size_t ParseResult::GetTokenCount() const
+{
+	return m_Data ? m_Data->m_Tokens.m_Tokens.size() : 0;
+}
+
+TokenKind ParseResult::GetKind(std::size_t index) const
+{
+	static_assert(int(TokenKind::RightCurlyBracket) == int(TokenType::RightCurlyBracket), "TokenKind has to mirror TokenType");
+	return TokenKind(m_Data->m_Tokens.m_Tokens[index].GetType());
+}
+
+std::string_view ParseResult::GetValue(std::size_t index) const
+{
+	return m_Data->m_Tokens.GetValue(m_Data->m_Tokens.m_Tokens[index]);
+}
+
+bool ParseResult::IsID(std::size_t index) const
+{
+	return m_Data->m_Tokens.m_Tokens[index].IsID();
+}
+
+char32_t ParseResult::GetDelim(std::size_t index) const
+{
+	return char32_t(m_Data->m_Tokens.m_Tokens[index].GetDelim().GetBytes());
+}
+
+bool ParseResult::IsInteger(std::size_t index) const
+{
+	return m_Data->m_Tokens.GetNumber(m_Data->m_Tokens.m_Tokens[index]).IsInteger();
+}
+
+std::int64_t ParseResult::GetInteger(std::size_t index) const
+{
+	return m_Data->m_Tokens.GetNumber(m_Data->m_Tokens.m_Tokens[index]).GetInteger();
+}
+
+double ParseResult::GetNumber(std::size_t index) const
+{
+	return m_Data->m_Tokens.GetNumber(m_Data->m_Tokens.m_Tokens[index]).GetNumber();
+}
+
+std::string_view ParseResult::GetUnit(std::size_t index) const
+{
+	CSS_PARSER_ASSERT(GetKind(index) == TokenKind::Dimension, "Only dimension tokens have a unit");
+	// The value of a dimension token is its unit.
+	return GetValue(index);
+}
+
+std::size_t ParseResult::GetPartner(std::size_t index) const
+{
+	const unsigned partner = m_Data->m_Tokens.m_Tokens[index].GetPartnerIndex();
+	return partner == Token::NO_PARTNER ? NO_PARTNER : partner;
+}
+
+namespace
+{
+ParseResult::Range ToRange(const IndexRange& range)
+{
+	return {range.m_Begin, range.m_End};
+}
+
+// The stylesheet indexes its rules, declarations and component values with 32 bits, like the tokens.
+unsigned ToIndex(std::size_t index)
+{
+	CSS_PARSER_ASSERT(index <= std::numeric_limits<unsigned>::max(), "Expects an index of the stylesheet");
+	return static_cast<unsigned>(index);
+}
+}
+
+ParseResult::Range ParseResult::GetRules()
+{
+	if (!m_Data)
+	{
+		return {};
+	}
+	return ToRange(m_Data->GetStyleSheet().GetRules());
+}
+
+RuleKind ParseResult::GetRuleKind(std::size_t rule) const
+{
+	static_assert(int(RuleKind::NestedDeclarations) == int(RuleType::NestedDeclarations), "RuleKind has to mirror RuleType");
+	return RuleKind(m_Data->GetStyleSheet().GetRule(ToIndex(rule)).m_Type);
+}
+
+std::string_view ParseResult::GetRuleName(std::size_t rule) const
+{
+	CSS_PARSER_ASSERT(GetRuleKind(rule) == RuleKind::At, "Only at-rules have a name");
+	return GetValue(m_Data->GetStyleSheet().GetRule(ToIndex(rule)).m_Name);
+}
+
+bool ParseResult::HasBlock(std::size_t rule) const
+{
+	return m_Data->GetStyleSheet().GetRule(ToIndex(rule)).m_HasBlock;
+}
+
+ParseResult::Range ParseResult::GetPrelude(std::size_t rule)
+{
+	return ToRange(m_Data->GetStyleSheet().GetPreludeValues(ToIndex(rule)));
+}
+
+ParseResult::Range ParseResult::GetDeclarations(std::size_t rule)
+{
+	return ToRange(m_Data->GetStyleSheet().GetDeclarations(ToIndex(rule)));
+}
+
+ParseResult::Range ParseResult::GetChildRules(std::size_t rule)
+{
+	return ToRange(m_Data->GetStyleSheet().GetChildRules(ToIndex(rule)));
+}
+
+std::string_view ParseResult::GetDeclarationName(std::size_t declaration) const
+{
+	return GetValue(m_Data->GetStyleSheet().GetDeclaration(ToIndex(declaration)).m_Name);
+}
+
+ParseResult::Range ParseResult::GetDeclarationValue(std::size_t declaration)
+{
+	return ToRange(m_Data->GetStyleSheet().GetDeclarationValues(ToIndex(declaration)));
+}
+
+bool ParseResult::IsImportant(std::size_t declaration) const
+{
+	return m_Data->GetStyleSheet().GetDeclaration(ToIndex(declaration)).m_IsImportant;
+}
+
+ComponentValueKind ParseResult::GetComponentValueKind(std::size_t value) const
+{
+	static_assert(int(ComponentValueKind::SimpleBlock) == int(ComponentValueType::SimpleBlock),
+		"ComponentValueKind has to mirror ComponentValueType");
+	return ComponentValueKind(m_Data->GetStyleSheet().GetComponentValue(ToIndex(value)).m_Type);
+}
+
+std::size_t ParseResult::GetComponentValueToken(std::size_t value) const
+{
+	return m_Data->GetStyleSheet().GetComponentValue(ToIndex(value)).m_Token;
+}
+
+ParseResult::Range ParseResult::GetComponentValueChildren(std::size_t value) const
+{
+	return ToRange(m_Data->GetStyleSheet().GetComponentValue(ToIndex(value)).m_Children);
+}
+
+ParseResult Tokenize(std::string source)
+{
+	ParseResult result;
+	// Tokenized after the move, so that the tokens refer to the owned source.
+	result.m_Data->m_Source = std::move(source);
+	ParseResult::Data& data = *result.m_Data;
+	data.m_IsValid = TokenizeInto(data.m_Source.data(), data.m_Source.size(), data.m_Tokens);
+	data.m_Tokens.ShrinkToFit();
+	return result;
+}
+
+ParseResult TokenizeFile(const char* path)
+{
+	ParseResult result;
+	ParseResult::Data& data = *result.m_Data;
+	if (data.m_File.Open(path))
+	{
+		data.m_IsValid = TokenizeInto(data.m_File.GetData(), data.m_File.GetSize(), data.m_Tokens);
+		data.m_Tokens.ShrinkToFit();
+	}
+	return result;
+}
+
+struct IncrementalTokenizer::State
+{
+	explicit State(MemoryResource* resource)
+		: m_Tokenizer(resource)
+	{
+	}
+
+	// Pairs the tokens appended since the previous call, see Token::GetPartnerIndex.
+	void PairTokens(Vector<Token>& tokens)
+	{
+		for (; m_PairedCount < tokens.size(); ++m_PairedCount)
+		{
+			PairToken(tokens, m_PairedCount, m_InnermostOpen);
+		}
+	}
+
+	StreamingTokenizer m_Tokenizer;
+	unsigned m_PairedCount = 0;
+	unsigned m_InnermostOpen = Token::NO_PARTNER;
+	bool m_IsValid = true;
+};
+
+IncrementalTokenizer::IncrementalTokenizer(std::pmr::memory_resource* resource)
+	: m_State(new State(resource))
+{
+}
+
+IncrementalTokenizer::~IncrementalTokenizer() = default;
+
+bool IncrementalTokenizer::Feed(const char* chunk, std::size_t size, ParseResult& result)
+{
+	CSS_PARSER_ASSERT(result.m_Data, "Expects a result that was not moved from");
+	State& state = *m_State;
+	if (state.m_IsValid)
+	{
+		TokenList& tokens = result.m_Data->m_Tokens;
+		state.m_IsValid = state.m_Tokenizer.Feed(chunk, size, tokens);
+		state.PairTokens(tokens.m_Tokens);
+	}
+	return state.m_IsValid;
+}
+
+bool IncrementalTokenizer::Finish(ParseResult& result)
+{
+	CSS_PARSER_ASSERT(result.m_Data, "Expects a result that was not moved from");
+	State& state = *m_State;
+	TokenList& tokens = result.m_Data->m_Tokens;
+	if (state.m_IsValid)
+	{
+		state.m_IsValid = state.m_Tokenizer.Finish(tokens);
+		state.PairTokens(tokens.m_Tokens);
+	}
+	else
+	{
+		// Finishing is still needed for the tokenizer to start over.
+		TokenList discarded;
+		state.m_Tokenizer.Finish(discarded);
+	}
+	LeaveUnclosed(tokens.m_Tokens, state.m_InnermostOpen);
+	tokens.ShrinkToFit();
+	result.m_Data->m_IsValid = state.m_IsValid;
+	state.m_PairedCount = 0;
+	state.m_InnermostOpen = Token::NO_PARTNER;
+	state.m_IsValid = true;
+	return result.m_Data->m_IsValid;
+}
+
+struct ParserContext::Buffers
+{
+	explicit Buffers(MemoryResource* resource)
+		: m_Tokenizer("", 0, TokenizerOptions(), resource)
+		, m_CodePoints(resource)
+		, m_Tokens(resource)
+	{
+	}
+
+	Tokenizer m_Tokenizer;
+	CodePointBuffer m_CodePoints;
+	TokenList m_Tokens;
+};
+
+ParserContext::ParserContext(std::pmr::memory_resource* resource)
+	: m_Buffers(new Buffers(resource))
+{
+}
+
+ParserContext::~ParserContext() = default;
+
+bool ParserContext::Parse(const char* text, std::size_t size)
+{
+	if (IsUTF8(text, size))
+	{
+		m_Buffers->m_Tokenizer.Reset(text, size);
+		return ParseUTF8(m_Buffers->m_Tokenizer);
+	}
+	return ParseCodePoints(text, size, m_Buffers->m_CodePoints, m_Buffers->m_Tokens);
+}
+
+bool ParserContext::ParseInPlace(char* text, std::size_t size)
+{
+	if (!IsUTF8(text, size))
+	{
+		return Parse(text, size);
+	}
+	m_Buffers->m_Tokenizer.Reset(text, PreprocessUTF8InPlace(text, size));
+	return ParseUTF8(m_Buffers->m_Tokenizer);
+}
 }
-}
\ No newline at end of file
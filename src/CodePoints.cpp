@@ -24,444 +24,748 @@ SOFTWARE.
 
 #include "CodePoints.h"
 #include "CSSParserAssert.h"
+#include "Kernels.h"
+
+#include <algorithm>
+#include <cstring>
 
 namespace css_parser
 {
-CodePoint::CodePoint(CodePointValue value)
-	: m_Value(static_cast<unsigned>(value))
+// https://encoding.spec.whatwg.org/#bom-sniff
+Encoding BOMSniff(const StringView& ioQueue, SizeType position)
 {
+	if (position + 2 > ioQueue.size())
+	{
+		return Encoding::Count;
+	}
+	const unsigned char BOM[3] = {
+		static_cast<unsigned char>(ioQueue[position]),
+		static_cast<unsigned char>(ioQueue[position + 1]),
+		position + 2 < ioQueue.size() ? static_cast<unsigned char>(ioQueue[position + 2]) : static_cast<unsigned char>(0)
+	};
+	if (BOM[0] == 0xEF)
+	{
+		if (BOM[1] == 0xBB && BOM[2] == 0xBF)
+		{
+			return Encoding::UTF8;
+		}
+	}
+	else if (BOM[0] == 0xFE)
+	{
+		if (BOM[1] == 0xFF)
+		{
+			return Encoding::UTF16BE;
+		}
+	}
+	else if (BOM[0] == 0xFF)
+	{
+		if (BOM[1] == 0xFE)
+		{
+			return Encoding::UTF16LE;
+		}
+	}
+	return Encoding::Count;
 }
 
-CodePoint::CodePoint(unsigned value)
-	: m_Value(value)
-{
+namespace
+{
+// https://bjoern.hoehrmann.de/utf-8/decoder/dfa/
+// UTF-8 is decoded by a DFA, so the boundaries https://encoding.spec.whatwg.org/#utf-8-decoder sets for the second
+// byte after E0, ED, F0 and F4 take table lookups instead of branches. Every byte has one of 12 classes:
+//   0: 00..7F, 1: 80..8F, 9: 90..9F, 7: A0..BF - ASCII and the continuation bytes, split by the boundaries
+//   2: C2..DF, 10: E0, 3: E1..EC and EE..EF, 4: ED, 11: F0, 6: F1..F3, 5: F4 - the lead bytes
+//   8: C0..C1 and F5..FF - never valid
+const unsigned char UTF8_BYTE_CLASSES[256] =
+{
+	0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+	0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+	0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+	0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+	1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 9, 9, 9, 9, 9, 9, 9, 9, 9, 9, 9, 9, 9, 9, 9, 9,
+	7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7,
+	8, 8, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2,
+	10, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 4, 3, 3, 11, 6, 6, 6, 5, 8, 8, 8, 8, 8, 8, 8, 8, 8, 8, 8
+};
+
+// The bits of a byte of each class that are part of the code point. The continuation bytes keep 6 bits,
+// the lead bytes those after their length prefix.
+const unsigned char UTF8_PAYLOAD_MASKS[12] =
+{
+	0xFF, 0x3F, 0x1F, 0x0F, 0x0F, 0x07, 0x07, 0x3F, 0x00, 0x3F, 0x0F, 0x07
+};
+
+// The states are multiples of the number of classes, so the next state is at state + class.
+constexpr unsigned char UTF8_ACCEPT = 0;
+constexpr unsigned char UTF8_REJECT = 12;
+
+// 0: between sequences, 12: an invalid byte, 24: one continuation byte left, 36: two left,
+// 48: after E0, 60: after ED, 72: after F0, 84: after F1..F3, 96: after F4.
+const unsigned char UTF8_TRANSITIONS[108] =
+{
+	0, 12, 24, 36, 60, 96, 84, 12, 12, 12, 48, 72,
+	12, 12, 12, 12, 12, 12, 12, 12, 12, 12, 12, 12,
+	12, 0, 12, 12, 12, 12, 12, 0, 12, 0, 12, 12,
+	12, 24, 12, 12, 12, 12, 12, 24, 12, 24, 12, 12,
+	12, 12, 12, 12, 12, 12, 12, 24, 12, 12, 12, 12,
+	12, 24, 12, 12, 12, 12, 12, 12, 12, 24, 12, 12,
+	12, 12, 12, 12, 12, 12, 12, 36, 12, 36, 12, 12,
+	12, 36, 12, 12, 12, 12, 12, 36, 12, 36, 12, 12,
+	12, 36, 12, 12, 12, 12, 12, 12, 12, 12, 12, 12
+};
 }
 
-unsigned CodePoint::GetBytes() const
+// https://encoding.spec.whatwg.org/#utf-8-decoder
+CodePoint DecodeUTF8CodePoint(const StringView& input, SizeType position, SizeType& length)
 {
-	return m_Value;
+	unsigned state = UTF8_ACCEPT;
+	unsigned codePoint = 0;
+	length = 0;
+	for (;;)
+	{
+		if (position + length == input.size())
+		{
+			return CodePoint(CodePointValue::REPLACEMENT);
+		}
+		const unsigned char byte = input[position + length];
+		const unsigned char byteClass = UTF8_BYTE_CLASSES[byte];
+		const unsigned nextState = UTF8_TRANSITIONS[state + byteClass];
+		if (nextState == UTF8_REJECT)
+		{
+			// An invalid lead byte is consumed, an invalid continuation byte is processed again
+			// as the start of the next sequence.
+			length += state == UTF8_ACCEPT;
+			return CodePoint(CodePointValue::REPLACEMENT);
+		}
+		codePoint = codePoint << 6 | (byte & UTF8_PAYLOAD_MASKS[byteClass]);
+		state = nextState;
+		++length;
+		if (state == UTF8_ACCEPT)
+		{
+			return CodePoint(codePoint);
+		}
+	}
 }
 
-bool operator==(const CodePoint& lhs, const CodePoint& rhs)
+void AppendUTF8(const CodePoint& codePoint, String& output)
 {
-	return lhs.GetBytes() == rhs.GetBytes();
+	const unsigned value = codePoint.GetBytes();
+	CSS_PARSER_ASSERT(!IsSurrogate(codePoint) && value <= static_cast<unsigned>(CodePointValue::MAXIMUM_ALLOWED_CODE_POINT),
+		"Only scalar values can be encoded");
+	if (value < 0x80)
+	{
+		output.push_back(static_cast<char>(value));
+		return;
+	}
+	char bytes[4];
+	SizeType count = 0;
+	if (value < 0x800)
+	{
+		bytes[count++] = static_cast<char>(0xC0 | (value >> 6));
+	}
+	else if (value < 0x10000)
+	{
+		bytes[count++] = static_cast<char>(0xE0 | (value >> 12));
+		bytes[count++] = static_cast<char>(0x80 | ((value >> 6) & 0x3F));
+	}
+	else
+	{
+		bytes[count++] = static_cast<char>(0xF0 | (value >> 18));
+		bytes[count++] = static_cast<char>(0x80 | ((value >> 12) & 0x3F));
+		bytes[count++] = static_cast<char>(0x80 | ((value >> 6) & 0x3F));
+	}
+	bytes[count++] = static_cast<char>(0x80 | (value & 0x3F));
+	output.append(bytes, count);
 }
 
-bool operator==(const CodePoint& lhs, unsigned rhs)
+void AppendCodePoint(const CodePoint& codePoint, Vector<CodePoint>& output)
 {
-	return lhs.GetBytes() == rhs;
+	output.push_back(codePoint);
 }
 
-bool operator==(unsigned lhs, const CodePoint& rhs)
+void AppendCodePoint(const CodePoint& codePoint, CodePointBuffer& output)
 {
-	return lhs == rhs.GetBytes();
+	output.Append(codePoint);
 }
 
-bool operator!=(const CodePoint& lhs, const CodePoint& rhs)
+// Includes the input preprocessing.
+// https://www.w3.org/TR/css-syntax-3/#input-preprocessing
+template <typename Output>
+void PushCodePoint(const CodePoint& codePoint, bool& isPreviousCarriageReturn, Output& output)
 {
-	return lhs.GetBytes() != rhs.GetBytes();
+	CSS_PARSER_ASSERT(!IsSurrogate(codePoint), "Decoding should not generate surrogates.");
+	// Everything the preprocessing changes is at most U+000D CARRIAGE RETURN (CR).
+	if (codePoint > CodePointValue::CARRIAGE_RETURN)
+	{
+		AppendCodePoint(codePoint, output);
+		isPreviousCarriageReturn = false;
+		return;
+	}
+	if (codePoint == CodePointValue::FORM_FEED)
+	{
+		AppendCodePoint(CodePoint(CodePointValue::LINE_FEED), output);
+		isPreviousCarriageReturn = false;
+		return;
+	}
+	if (codePoint == CodePointValue::CARRIAGE_RETURN)
+	{
+		isPreviousCarriageReturn = true;
+		AppendCodePoint(CodePoint(CodePointValue::LINE_FEED), output);
+		return;
+	}
+	if (codePoint == CodePointValue::LINE_FEED)
+	{
+		if (!isPreviousCarriageReturn)
+		{
+			AppendCodePoint(CodePoint(CodePointValue::LINE_FEED), output);
+		}
+		isPreviousCarriageReturn = false;
+		return;
+	}
+	if (codePoint == CodePointValue::NULL_CODE_POINT)
+	{
+		AppendCodePoint(CodePoint(CodePointValue::REPLACEMENT), output);
+		isPreviousCarriageReturn = false;
+		return;
+	}
+	AppendCodePoint(codePoint, output);
+	isPreviousCarriageReturn = false;
 }
 
-bool operator!=(const CodePoint& lhs, unsigned rhs)
+// Appends count code points that widen, a kernel like WidenASCII, writes as 32-bit values. They are widened a block
+// at a time into memory that stays in the cache and appended from there, so that output is written once instead of
+// being filled with zeros first.
+template <typename Widen>
+void AppendWidened(SizeType count, const Widen& widen, Vector<CodePoint>& output)
 {
-	return lhs.GetBytes() != rhs;
+	static_assert(sizeof(CodePoint) == sizeof(unsigned), "Code points are widened as 32-bit values");
+	constexpr SizeType BLOCK_SIZE = 256;
+	unsigned block[BLOCK_SIZE];
+	for (SizeType position = 0; position < count; position += BLOCK_SIZE)
+	{
+		const SizeType blockCount = std::min(BLOCK_SIZE, count - position);
+		widen(position, blockCount, block);
+		const CodePoint* codePoints = reinterpret_cast<const CodePoint*>(block);
+		output.insert(output.end(), codePoints, codePoints + blockCount);
+	}
 }
 
-bool operator!=(unsigned lhs, const CodePoint& rhs)
+void AppendASCIIRun(const char* text, SizeType count, Vector<CodePoint>& output)
 {
-	return lhs != rhs.GetBytes();
+	const auto widen = [text](SizeType position, SizeType blockCount, unsigned* block)
+	{
+		WidenASCII(text + position, blockCount, block);
+	};
+	AppendWidened(count, widen, output);
 }
 
-bool operator>=(const CodePoint& lhs, const CodePoint& rhs)
+void AppendASCIIRun(const char* text, SizeType count, CodePointBuffer& output)
 {
-	return lhs.GetBytes() >= rhs.GetBytes();
+	output.AppendASCII(text, count);
 }
 
-bool operator>=(const CodePoint& lhs, unsigned rhs)
+// Appends the plain ASCII run starting at inputPosition without going through the decoder state machine.
+template <typename Output>
+void PushPlainASCII(const StringView& input, SizeType& inputPosition, Output& output)
 {
-	return lhs.GetBytes() >= rhs;
+	const SizeType run = ScanPlainASCII(input.data() + inputPosition, input.size() - inputPosition);
+	AppendASCIIRun(input.data() + inputPosition, run, output);
+	inputPosition += run;
 }
 
-bool operator>=(unsigned lhs, const CodePoint& rhs)
+UTF8Decoder::UTF8Decoder()
+	: m_CodePoint(0)
+	, m_State(UTF8_ACCEPT)
+	, m_IsPreviousCarriageReturn(false)
+	, m_IsFinished(false)
 {
-	return lhs >= rhs.GetBytes();
 }
 
-bool operator<=(const CodePoint& lhs, const CodePoint& rhs)
+void UTF8Decoder::Decode(const StringView& input, Vector<CodePoint>& output)
 {
-	return lhs.GetBytes() <= rhs.GetBytes();
+	DecodeInto(input, output);
 }
 
-bool operator<=(const CodePoint& lhs, unsigned rhs)
+void UTF8Decoder::Decode(const StringView& input, CodePointBuffer& output)
 {
-	return lhs.GetBytes() <= rhs;
+	DecodeInto(input, output);
 }
 
-bool operator<=(unsigned lhs, const CodePoint& rhs)
+void UTF8Decoder::Finish(Vector<CodePoint>& output)
 {
-	return lhs <= rhs.GetBytes();
+	FinishInto(output);
 }
 
-bool operator>(const CodePoint& lhs, const CodePoint& rhs)
+void UTF8Decoder::Finish(CodePointBuffer& output)
 {
-	return lhs.GetBytes() > rhs.GetBytes();
+	FinishInto(output);
 }
 
-bool operator>(const CodePoint& lhs, unsigned rhs)
+// https://encoding.spec.whatwg.org/#concept-encoding-run
+// https://encoding.spec.whatwg.org/#utf-8-decoder
+template <typename Output>
+void UTF8Decoder::DecodeInto(const StringView& input, Output& output)
 {
-	return lhs.GetBytes() > rhs;
+	SizeType inputPosition = 0;
+	while (!m_IsFinished && inputPosition < input.size())
+	{
+		if (m_State == UTF8_ACCEPT && !m_IsPreviousCarriageReturn)
+		{
+			PushPlainASCII(input, inputPosition, output);
+			if (inputPosition == input.size())
+			{
+				break;
+			}
+		}
+		const unsigned char byte = input[inputPosition];
+		if (byte == '\0')
+		{
+			FinishInto(output);
+			return;
+		}
+		const unsigned char byteClass = UTF8_BYTE_CLASSES[byte];
+		const unsigned char nextState = UTF8_TRANSITIONS[m_State + byteClass];
+		if (nextState == UTF8_REJECT)
+		{
+			// An invalid lead byte is consumed, an invalid continuation byte is processed again
+			// as the start of the next sequence.
+			inputPosition += m_State == UTF8_ACCEPT;
+			m_CodePoint = 0;
+			m_State = UTF8_ACCEPT;
+			PushCodePoint(CodePoint(CodePointValue::REPLACEMENT), m_IsPreviousCarriageReturn, output);
+			continue;
+		}
+		m_CodePoint = m_CodePoint << 6 | (byte & UTF8_PAYLOAD_MASKS[byteClass]);
+		m_State = nextState;
+		++inputPosition;
+		if (m_State == UTF8_ACCEPT)
+		{
+			PushCodePoint(CodePoint(m_CodePoint), m_IsPreviousCarriageReturn, output);
+			m_CodePoint = 0;
+		}
+	}
 }
 
-bool operator>(unsigned lhs, const CodePoint& rhs)
+template <typename Output>
+void UTF8Decoder::FinishInto(Output& output)
 {
-	return lhs > rhs.GetBytes();
+	if (m_State != UTF8_ACCEPT)
+	{
+		PushCodePoint(CodePoint(CodePointValue::REPLACEMENT), m_IsPreviousCarriageReturn, output);
+	}
+	m_CodePoint = 0;
+	m_State = UTF8_ACCEPT;
+	m_IsFinished = true;
 }
 
-bool operator<(const CodePoint& lhs, const CodePoint& rhs)
+void AppendUTF16Run(const char* text, SizeType count, bool isBigEndian, Vector<CodePoint>& output)
 {
-	return lhs.GetBytes() < rhs.GetBytes();
+	const auto widen = [text, isBigEndian](SizeType position, SizeType blockCount, unsigned* block)
+	{
+		WidenUTF16(text + 2 * position, blockCount, isBigEndian, block);
+	};
+	AppendWidened(count, widen, output);
 }
 
-bool operator<(const CodePoint& lhs, unsigned rhs)
+void AppendUTF16Run(const char* text, SizeType count, bool isBigEndian, CodePointBuffer& output)
 {
-	return lhs.GetBytes() < rhs;
+	output.AppendUTF16(text, count, isBigEndian);
 }
 
-bool operator<(unsigned lhs, const CodePoint& rhs)
+// Appends the run of code units starting at inputPosition that decode to themselves and are left unchanged
+// by the input preprocessing.
+template <typename Output>
+void PushPlainUTF16(const StringView& input, SizeType& inputPosition, bool isBigEndian, Output& output)
 {
-	return lhs < rhs.GetBytes();
+	const SizeType run = ScanPlainUTF16(input.data() + inputPosition, (input.size() - inputPosition) / 2, isBigEndian);
+	AppendUTF16Run(input.data() + inputPosition, run, isBigEndian, output);
+	inputPosition += 2 * run;
 }
 
-bool operator==(const CodePoint& lhs, CodePointValue rhs)
+UTF16Decoder::UTF16Decoder(bool isBigEndian)
+	: m_LeadSurrogate(0)
+	, m_LeadByte(0)
+	, m_HasLeadByte(false)
+	, m_IsBigEndian(isBigEndian)
+	, m_IsPreviousCarriageReturn(false)
 {
-	return lhs.GetBytes() == static_cast<unsigned>(rhs);
 }
 
-bool operator==(CodePointValue lhs, const CodePoint& rhs)
+void UTF16Decoder::Decode(const StringView& input, Vector<CodePoint>& output)
 {
-	return static_cast<unsigned>(lhs) == rhs.GetBytes();
+	DecodeInto(input, output);
 }
 
-bool operator!=(const CodePoint& lhs, CodePointValue rhs)
+void UTF16Decoder::Decode(const StringView& input, CodePointBuffer& output)
 {
-	return lhs.GetBytes() != static_cast<unsigned>(rhs);
+	DecodeInto(input, output);
 }
 
-bool operator!=(CodePointValue lhs, const CodePoint& rhs)
+void UTF16Decoder::Finish(Vector<CodePoint>& output)
 {
-	return static_cast<unsigned>(lhs) != rhs.GetBytes();
+	FinishInto(output);
 }
 
-bool operator>=(const CodePoint& lhs, CodePointValue rhs)
+void UTF16Decoder::Finish(CodePointBuffer& output)
 {
-	return lhs.GetBytes() >= static_cast<unsigned>(rhs);
+	FinishInto(output);
 }
 
-bool operator>=(CodePointValue lhs, const CodePoint& rhs)
+template <typename Output>
+void UTF16Decoder::DecodeInto(const StringView& input, Output& output)
 {
-	return static_cast<unsigned>(lhs) >= rhs.GetBytes();
+	SizeType inputPosition = 0;
+	while (inputPosition < input.size())
+	{
+		if (!m_HasLeadByte && m_LeadSurrogate == 0 && !m_IsPreviousCarriageReturn)
+		{
+			PushPlainUTF16(input, inputPosition, m_IsBigEndian, output);
+			if (inputPosition == input.size())
+			{
+				break;
+			}
+		}
+		const unsigned char byte = input[inputPosition++];
+		if (!m_HasLeadByte)
+		{
+			m_LeadByte = byte;
+			m_HasLeadByte = true;
+			continue;
+		}
+		m_HasLeadByte = false;
+		const unsigned codeUnit = m_IsBigEndian ? (m_LeadByte << 8) | byte : (byte << 8) | m_LeadByte;
+		DecodeCodeUnit(codeUnit, output);
+	}
 }
 
-bool operator<=(const CodePoint& lhs, CodePointValue rhs)
+template <typename Output>
+void UTF16Decoder::DecodeCodeUnit(unsigned codeUnit, Output& output)
 {
-	return lhs.GetBytes() <= static_cast<unsigned>(rhs);
+	const CodePoint codePoint(codeUnit);
+	if (m_LeadSurrogate != 0)
+	{
+		const unsigned leadSurrogate = m_LeadSurrogate;
+		m_LeadSurrogate = 0;
+		if (IsTrailingSurrogate(codePoint))
+		{
+			PushCodePoint(CodePoint(0x10000 + ((leadSurrogate - 0xD800) << 10) + (codeUnit - 0xDC00)), m_IsPreviousCarriageReturn, output);
+			return;
+		}
+		// The code unit is not a trailing surrogate, it is processed again after the replacement.
+		PushCodePoint(CodePoint(CodePointValue::REPLACEMENT), m_IsPreviousCarriageReturn, output);
+	}
+	if (IsLeadingSurrogate(codePoint))
+	{
+		m_LeadSurrogate = codeUnit;
+		return;
+	}
+	if (IsTrailingSurrogate(codePoint))
+	{
+		PushCodePoint(CodePoint(CodePointValue::REPLACEMENT), m_IsPreviousCarriageReturn, output);
+		return;
+	}
+	PushCodePoint(codePoint, m_IsPreviousCarriageReturn, output);
 }
 
-bool operator<=(CodePointValue lhs, const CodePoint& rhs)
+template <typename Output>
+void UTF16Decoder::FinishInto(Output& output)
 {
-	return static_cast<unsigned>(lhs) <= rhs.GetBytes();
+	if (m_HasLeadByte || m_LeadSurrogate != 0)
+	{
+		PushCodePoint(CodePoint(CodePointValue::REPLACEMENT), m_IsPreviousCarriageReturn, output);
+	}
+	m_LeadSurrogate = 0;
+	m_HasLeadByte = false;
 }
 
-bool operator>(const CodePoint& lhs, CodePointValue rhs)
+void PadWithEndOfFile(Vector<CodePoint>& codePoints)
 {
-	return lhs.GetBytes() > static_cast<unsigned>(rhs);
+	codePoints.insert(codePoints.end(), END_OF_FILE_PADDING, CodePoint(CodePointValue::END_OF_FILE));
 }
 
-bool operator>(CodePointValue lhs, const CodePoint& rhs)
+namespace
 {
-	return static_cast<unsigned>(lhs) > rhs.GetBytes();
-}
-
-bool operator<(const CodePoint& lhs, CodePointValue rhs)
+// Writes the preprocessed bytes of text to output, which may be text itself as they are never more.
+// Returns the number of bytes written.
+SizeType PreprocessUTF8(const char* text, SizeType size, char* output)
 {
-	return lhs.GetBytes() < static_cast<unsigned>(rhs);
+	SizeType inputPosition = 0;
+	SizeType outputPosition = 0;
+	for (;;)
+	{
+		const SizeType run = FindPreprocessedByte(text + inputPosition, size - inputPosition);
+		if (output + outputPosition != text + inputPosition)
+		{
+			std::memmove(output + outputPosition, text + inputPosition, run);
+		}
+		inputPosition += run;
+		outputPosition += run;
+		if (inputPosition == size || text[inputPosition] == '\0')
+		{
+			return outputPosition;
+		}
+		const bool isCRLF = text[inputPosition] == '\r' && inputPosition + 1 < size && text[inputPosition + 1] == '\n';
+		inputPosition += isCRLF ? 2 : 1;
+		output[outputPosition++] = '\n';
+	}
 }
-
-bool operator<(CodePointValue lhs, const CodePoint& rhs)
-{
-	return static_cast<unsigned>(lhs) < rhs.GetBytes();
 }
 
-bool IsNewline(const CodePoint& codePoint)
+void PreprocessUTF8(const StringView& input, String& output)
 {
-	// https://www.w3.org/TR/css-syntax-3/#newline
-	return codePoint == CodePointValue::LINE_FEED;
+	output.resize(input.size());
+	output.resize(PreprocessUTF8(input.data(), input.size(), &output[0]));
 }
 
-bool IsLeadingSurrogate(const CodePoint& codePoint)
+SizeType PreprocessUTF8InPlace(char* text, SizeType size)
 {
-	return codePoint >= 0xD800 && codePoint <= 0xDBFF;
+	return PreprocessUTF8(text, size, text);
 }
 
-bool IsTrailingSurrogate(const CodePoint& codePoint)
+namespace
 {
-	return codePoint >= 0xDC00 && codePoint <= 0xDFFF;
-}
-
-bool IsSurrogate(const CodePoint& codePoint)
+void StartDecoding(SizeType expectedCount, Vector<CodePoint>& output)
 {
-	return IsLeadingSurrogate(codePoint) || IsTrailingSurrogate(codePoint);
+	output.clear();
+	output.reserve(expectedCount + END_OF_FILE_PADDING);
 }
 
-bool IsScalarValue(const CodePoint& codePoint)
+void StartDecoding(SizeType expectedCount, CodePointBuffer& output)
 {
-	return !IsSurrogate(codePoint);
+	output.Start(expectedCount);
 }
 
-bool IsWhitespace(const CodePoint& codePoint)
+void EndDecoding(Vector<CodePoint>& output)
 {
-	return IsNewline(codePoint)
-		|| codePoint == CodePointValue::CHARACTER_TABULATION
-		|| codePoint == CodePointValue::SPACE;
+	PadWithEndOfFile(output);
 }
 
-bool IsDigit(const CodePoint& codePoint)
+void EndDecoding(CodePointBuffer& output)
 {
-	return codePoint >= CodePointValue::ZERO && codePoint <= CodePointValue::NINE;
+	output.End();
 }
 
-bool IsHexDigit(const CodePoint& codePoint)
+// https://www.w3.org/TR/css-syntax-3/#input-byte-stream
+// When parsing a stylesheet, the stream of Unicode code points that comprises the input to the
+// tokenization stage might be initially seen by the user agent as a stream of bytes
+// (typically coming over the network or from the local file system). If so, the user agent must decode these bytes
+// into code points according to a particular character encoding.
+// https://encoding.spec.whatwg.org/#decode
+// Decode stylesheets stream of bytes with fallback encoding fallback, and return the result.
+template <typename Output>
+void Decode(const char* text, SizeType size, Output& output)
 {
-	return (IsDigit(codePoint))
-		|| (codePoint >= CodePointValue::LATIN_CAPITAL_LETTER_A && codePoint <= CodePointValue::LATIN_CAPITAL_LETTER_F)
-		|| (codePoint >= CodePointValue::LATIN_SMALL_LETTER_A && codePoint <= CodePointValue::LATIN_SMALL_LETTER_F);
+	StringView ioQueue(text, size);
+	SizeType ioQueuePosition = 0;
+	const Encoding BOMEncoding = BOMSniff(ioQueue, ioQueuePosition);
+	if (BOMEncoding != Encoding::Count)
+	{
+		// Read three bytes from ioQueue, if BOMEncoding is UTF-8; otherwise read two bytes. (Do nothing with those bytes.)
+		ioQueuePosition += BOMEncoding == Encoding::UTF8 ? 3 : 2;
+	}
+	const StringView input = ioQueue.substr(ioQueuePosition);
+	if (BOMEncoding == Encoding::UTF16BE || BOMEncoding == Encoding::UTF16LE)
+	{
+		// Surrogate pairs and CR LF pairs aside, every two bytes are a code point.
+		StartDecoding(input.size() / 2 + 1, output);
+		UTF16Decoder decoder(BOMEncoding == Encoding::UTF16BE);
+		decoder.Decode(input, output);
+		decoder.Finish(output);
+		EndDecoding(output);
+		return;
+	}
+	// Exact for valid UTF-8 without CR LF pairs, so the code points are not moved as they are appended.
+	StartDecoding(CountUTF8LeadBytes(input.data(), input.size()), output);
+	UTF8Decoder decoder;
+	decoder.Decode(input, output);
+	decoder.Finish(output);
+	EndDecoding(output);
+}
 }
 
-bool IsUppercaseLetter(const CodePoint& codePoint)
+bool CreateCodePointsStream(const char* text, SizeType size, Vector<CodePoint>& output)
 {
-	return codePoint >= CodePointValue::LATIN_CAPITAL_LETTER_A && codePoint <= CodePointValue::LATIN_CAPITAL_LETTER_Z;
+	Decode(text, size, output);
+	return true;
 }
 
-bool IsLowercaseLetter(const CodePoint& codePoint)
+namespace
 {
-	return codePoint >= CodePointValue::LATIN_SMALL_LETTER_A && codePoint <= CodePointValue::LATIN_SMALL_LETTER_Z;
+template <typename Wide, typename Narrow>
+void WidenCodeUnits(Vector<Narrow>& narrow, SizeType expectedCount, Vector<Wide>& wide)
+{
+	wide.clear();
+	wide.reserve(std::max(expectedCount, narrow.size()) + END_OF_FILE_PADDING);
+	for (const Narrow codeUnit : narrow)
+	{
+		wide.push_back(Wide(codeUnit));
+	}
+	narrow.clear();
 }
 
-bool IsLetter(const CodePoint& codePoint)
+// Releases the memory of code units that are not used for the current input.
+template <typename CodeUnit>
+void Release(Vector<CodeUnit>& codeUnits)
 {
-	return IsUppercaseLetter(codePoint) || IsLowercaseLetter(codePoint);
+	codeUnits.clear();
+	codeUnits.shrink_to_fit();
+}
 }
 
-bool IsNonASCII(const CodePoint& codePoint)
+CodePointBuffer::CodePointBuffer(MemoryResource* resource)
+	: m_Latin1(resource)
+	, m_UCS2(resource)
+	, m_UTF32(resource)
+	, m_CodeUnitSize(1)
+	, m_ExpectedCount(0)
 {
-	return codePoint >= CodePointValue::CONTROL;
+	m_Latin1.assign(END_OF_FILE_PADDING, 0);
 }
 
-bool IsIdentStart(const CodePoint& codePoint)
+void CodePointBuffer::Start(SizeType expectedCount)
 {
-	return IsLetter(codePoint) || IsNonASCII(codePoint) || codePoint == CodePointValue::LOW_LINE;
+	m_CodeUnitSize = 1;
+	m_ExpectedCount = expectedCount;
+	m_Latin1.clear();
+	m_UCS2.clear();
+	m_UTF32.clear();
+	m_Latin1.reserve(expectedCount + END_OF_FILE_PADDING);
 }
 
-bool IsIdent(const CodePoint& codePoint)
+void CodePointBuffer::Append(const CodePoint& codePoint)
 {
-	return IsIdentStart(codePoint) || IsDigit(codePoint) || codePoint == CodePointValue::HYPHEN_MINUS;
+	const unsigned value = codePoint.GetBytes();
+	if (value > 0xFF && m_CodeUnitSize == 1)
+	{
+		Widen(value > 0xFFFF ? 4 : 2);
+	}
+	else if (value > 0xFFFF && m_CodeUnitSize == 2)
+	{
+		Widen(4);
+	}
+	switch (m_CodeUnitSize)
+	{
+	case 1:
+		m_Latin1.push_back(static_cast<unsigned char>(value));
+		break;
+	case 2:
+		m_UCS2.push_back(static_cast<char16_t>(value));
+		break;
+	default:
+		m_UTF32.push_back(codePoint);
+		break;
+	}
 }
 
-bool IsNonPrintable(const CodePoint& codePoint)
+void CodePointBuffer::AppendASCII(const char* text, SizeType count)
 {
-	return (codePoint >= CodePointValue::NULL_CODE_POINT && codePoint <= CodePointValue::BACKSPACE)
-		|| (codePoint == CodePointValue::LINE_TABULATION)
-		|| (codePoint >= CodePointValue::SHIFT_OUT && codePoint <= CodePointValue::INFORMATION_SEPARATOR_ONE)
-		|| (codePoint == CodePointValue::DELETE);
+	switch (m_CodeUnitSize)
+	{
+	case 1:
+		m_Latin1.insert(m_Latin1.end(), text, text + count);
+		break;
+	case 2:
+		m_UCS2.insert(m_UCS2.end(), text, text + count);
+		break;
+	default:
+		AppendASCIIRun(text, count, m_UTF32);
+		break;
+	}
 }
 
-// https://encoding.spec.whatwg.org/#bom-sniff
-Encoding BOMSniff(const StringView& ioQueue, SizeType position)
+void CodePointBuffer::AppendUTF16(const char* text, SizeType count, bool isBigEndian)
 {
-	if (position + 3 > ioQueue.size())
+	const unsigned char* bytes = reinterpret_cast<const unsigned char*>(text);
+	if (m_CodeUnitSize == 4)
 	{
-		return Encoding::Count;
+		AppendUTF16Run(text, count, isBigEndian, m_UTF32);
+		return;
 	}
-	const char BOM[3] = { ioQueue[position], ioQueue[position + 1], ioQueue[position + 2] };
-	if (BOM[0] == 0xEF)
+	// The byte of each code unit that holds its high bits.
+	const SizeType high = isBigEndian ? 0 : 1;
+	if (m_CodeUnitSize == 1)
 	{
-		if (BOM[1] == 0xBB && BOM[2] == 0xBF)
+		SizeType i = 0;
+		while (i < count && bytes[2 * i + high] == 0)
 		{
-			return Encoding::UTF8;
+			m_Latin1.push_back(bytes[2 * i + 1 - high]);
+			++i;
 		}
-	}
-	else if (BOM[0] == 0xFE)
-	{
-		if (BOM[1] == 0xFF)
+		if (i == count)
 		{
-			return Encoding::UTF16BE;
+			return;
 		}
+		Widen(2);
+		bytes += 2 * i;
+		count -= i;
 	}
-	else if (BOM[0] == 0xFF)
+	for (SizeType i = 0; i < count; ++i)
 	{
-		if (BOM[1] == 0xFE)
-		{
-			return Encoding::UTF16LE;
-		}
+		m_UCS2.push_back(static_cast<char16_t>(bytes[2 * i + high] << 8 | bytes[2 * i + 1 - high]));
 	}
-	return Encoding::Count;
 }
 
-// Includes the input preprocessing.
-// https://www.w3.org/TR/css-syntax-3/#input-preprocessing
-void PushCodePoint(const CodePoint& codePoint, bool& isPreviousCarriageReturn, Vector<CodePoint>& output)
+void CodePointBuffer::End()
 {
-	CSS_PARSER_ASSERT(!IsSurrogate(codePoint), "Decoding a UTF8 stream should not generate surrogates.");
-	if (codePoint == CodePointValue::FORM_FEED)
+	switch (m_CodeUnitSize)
 	{
-		output.push_back(CodePoint(CodePointValue::LINE_FEED));
-		isPreviousCarriageReturn = false;
-		return;
+	case 1:
+		m_Latin1.insert(m_Latin1.end(), END_OF_FILE_PADDING, 0);
+		Release(m_UCS2);
+		Release(m_UTF32);
+		break;
+	case 2:
+		m_UCS2.insert(m_UCS2.end(), END_OF_FILE_PADDING, 0);
+		Release(m_Latin1);
+		Release(m_UTF32);
+		break;
+	default:
+		PadWithEndOfFile(m_UTF32);
+		Release(m_Latin1);
+		Release(m_UCS2);
+		break;
 	}
-	if (codePoint == CodePointValue::CARRIAGE_RETURN)
+}
+
+void CodePointBuffer::Widen(unsigned codeUnitSize)
+{
+	if (codeUnitSize == 2)
 	{
-		isPreviousCarriageReturn = true;
-		output.push_back(CodePoint(CodePointValue::LINE_FEED));
-		return;
+		WidenCodeUnits(m_Latin1, m_ExpectedCount, m_UCS2);
 	}
-	if (codePoint == CodePointValue::LINE_FEED)
+	else if (m_CodeUnitSize == 1)
 	{
-		if (!isPreviousCarriageReturn)
-		{
-			output.push_back(CodePoint(CodePointValue::LINE_FEED));
-		}
-		isPreviousCarriageReturn = false;
-		return;
+		WidenCodeUnits(m_Latin1, m_ExpectedCount, m_UTF32);
 	}
-	if (codePoint == CodePointValue::NULL_CODE_POINT)
+	else
 	{
-		output.push_back(CodePoint(CodePointValue::REPLACEMENT));
-		isPreviousCarriageReturn = false;
-		return;
+		WidenCodeUnits(m_UCS2, m_ExpectedCount, m_UTF32);
 	}
-	output.push_back(codePoint);
+	m_CodeUnitSize = codeUnitSize;
 }
 
-// https://encoding.spec.whatwg.org/#concept-encoding-run
-// https://encoding.spec.whatwg.org/#utf-8-decoder
-void UTF8Decode(const StringView& input, SizeType& inputPosition, Vector<CodePoint>& output)
+unsigned CodePointBuffer::GetCodeUnitSize() const
 {
-	unsigned codePoint = 0;
-	unsigned char bytesSeen = 0;
-	unsigned char bytesNeeded = 0;
-	unsigned char lowerBoundary = 0x80;
-	unsigned char upperBoundary = 0xBF;
-	bool isPreviousCarriageReturn = false;
-	while (inputPosition < input.size())
-	{
-		unsigned char byte = input[inputPosition];
-		if (byte == '\0')
-		{
-			if (bytesNeeded != 0)
-			{
-				PushCodePoint(CodePoint(CodePointValue::REPLACEMENT), isPreviousCarriageReturn, output);
-				return;
-			}
-			return;
-		}
-		if (bytesNeeded == 0)
-		{
-			if (byte >= 0x00 && byte <= 0x7F)
-			{
-				PushCodePoint(CodePoint(byte), isPreviousCarriageReturn, output);
-			}
-			else if (byte >= 0xC2 && byte <= 0xDF)
-			{
-				bytesNeeded = 1;
-				codePoint = byte & 0x1F;
-			}
-			else if (byte >= 0xE0 && byte <= 0xEF)
-			{
-				if (byte == 0xE0)
-				{
-					lowerBoundary = 0xA0;
-				}
-				else if (byte == 0xED)
-				{
-					upperBoundary = 0x9F;
-				}
-				bytesNeeded = 2;
-				codePoint = byte & 0xF;
-			}
-			else if (byte >= 0xF0 && byte <= 0xF4)
-			{
-				if (byte == 0xF0)
-				{
-					lowerBoundary = 0x90;
-				}
-				else if (byte == 0xF4)
-				{
-					upperBoundary = 0x8F;
-				}
-				bytesNeeded = 3;
-				codePoint = byte & 0x7;
-			}
-			else
-			{
-				PushCodePoint(CodePoint(CodePointValue::REPLACEMENT), isPreviousCarriageReturn, output);
-			}
-			++inputPosition;
-			continue;
-		}
-		if (byte < lowerBoundary || byte > upperBoundary)
-		{
-			codePoint = 0;
-			bytesNeeded = 0;
-			bytesSeen = 0;
-			lowerBoundary = 0x80;
-			upperBoundary = 0xBF;
-			PushCodePoint(CodePoint(CodePointValue::REPLACEMENT), isPreviousCarriageReturn, output);
-			continue;
-		}
-		lowerBoundary = 0x80;
-		upperBoundary = 0xBF;
-		codePoint = codePoint << 6 | (byte & 0x3F);
-		++inputPosition;
-		if (++bytesSeen != bytesNeeded)
-		{
-			continue;
-		}
-		PushCodePoint(CodePoint(codePoint), isPreviousCarriageReturn, output);
-		codePoint = 0;
-		bytesNeeded = 0;
-		bytesSeen = 0;
-	}
-	if (bytesNeeded != 0)
-	{
-		PushCodePoint(CodePoint(CodePointValue::REPLACEMENT), isPreviousCarriageReturn, output);
-	}
+	return m_CodeUnitSize;
 }
 
+const Vector<unsigned char>& CodePointBuffer::GetLatin1() const
+{
+	return m_Latin1;
+}
 
-// https://www.w3.org/TR/css-syntax-3/#input-byte-stream
-// When parsing a stylesheet, the stream of Unicode code points that comprises the input to the
-// tokenization stage might be initially seen by the user agent as a stream of bytes
-// (typically coming over the network or from the local file system). If so, the user agent must decode these bytes
-// into code points according to a particular character encoding.
-// https://encoding.spec.whatwg.org/#decode
-// Decode stylesheets stream of bytes with fallback encoding fallback, and return the result.
-bool CreateCodePointsStream(const char* text, unsigned size, Vector<CodePoint>& output)
+const Vector<char16_t>& CodePointBuffer::GetUCS2() const
 {
-	StringView ioQueue(text, size);
-	SizeType ioQueuePosition = 0;
-	const Encoding BOMEncoding = BOMSniff(ioQueue, ioQueuePosition);
-	if (BOMEncoding != Encoding::Count)
-	{
-		if (BOMEncoding != Encoding::UTF8)
-		{
-			CSS_PARSER_ASSERT(false, "Unsupported encoding");
-			return false;
-		}
-		// Read three bytes from ioQueue, if BOMEncoding is UTF-8; otherwise read two bytes. (Do nothing with those bytes.)
-		ioQueuePosition += 3;
-	}
-	output.clear();
-	UTF8Decode(ioQueue, ioQueuePosition, output);
+	return m_UCS2;
+}
+
+const Vector<CodePoint>& CodePointBuffer::GetUTF32() const
+{
+	return m_UTF32;
+}
+
+bool CreateCodePointsStream(const char* text, SizeType size, CodePointBuffer& output)
+{
+	Decode(text, size, output);
 	return true;
 }
-}
\ No newline at end of file
+}
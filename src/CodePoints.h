@@ -83,7 +83,9 @@ enum class CodePointValue : unsigned
 	DELETE = 0x007F,
 	CONTROL = 0x0080,
 	REPLACEMENT = 0xFFFD,
-	MAXIMUM_ALLOWED_CODE_POINT = 0x10FFFF // https://www.w3.org/TR/css-syntax-3/#maximum-allowed-code-point
+	MAXIMUM_ALLOWED_CODE_POINT = 0x10FFFF, // https://www.w3.org/TR/css-syntax-3/#maximum-allowed-code-point
+	// Not a code point. Returned by the input streams when looking past the last code point.
+	END_OF_FILE = 0xFFFFFFFF
 };
 
 enum class Encoding
@@ -100,76 +102,439 @@ enum class Encoding
 struct CodePoint
 {
 public:
-	explicit CodePoint(CodePointValue value);
-	explicit CodePoint(unsigned value);
-	unsigned GetBytes() const;
+	constexpr explicit CodePoint(CodePointValue value);
+	constexpr explicit CodePoint(unsigned value);
+	constexpr unsigned GetBytes() const;
 private:
 	unsigned m_Value;
 };
 
-bool operator==(const CodePoint& lhs, const CodePoint& rhs);
-bool operator!=(const CodePoint& lhs, const CodePoint& rhs);
-bool operator>=(const CodePoint& lhs, const CodePoint& rhs);
-bool operator<=(const CodePoint& lhs, const CodePoint& rhs);
-bool operator>(const CodePoint& lhs, const CodePoint& rhs);
-bool operator<(const CodePoint& lhs, const CodePoint& rhs);
-
-bool operator==(const CodePoint& lhs, unsigned rhs);
-bool operator==(unsigned lhs, const CodePoint& rhs);
-bool operator!=(const CodePoint& lhs, unsigned rhs);
-bool operator!=(unsigned lhs, const CodePoint& rhs);
-bool operator>=(const CodePoint& lhs, unsigned rhs);
-bool operator>=(unsigned lhs, const CodePoint& rhs);
-bool operator<=(const CodePoint& lhs, unsigned rhs);
-bool operator<=(unsigned lhs, const CodePoint& rhs);
-bool operator>(const CodePoint& lhs, unsigned rhs);
-bool operator>(unsigned lhs, const CodePoint& rhs);
-bool operator<(const CodePoint& lhs, unsigned rhs);
-bool operator<(unsigned lhs, const CodePoint& rhs);
-
-bool operator==(const CodePoint& lhs, CodePointValue rhs);
-bool operator==(CodePointValue lhs, const CodePoint& rhs);
-bool operator!=(const CodePoint& lhs, CodePointValue rhs);
-bool operator!=(CodePointValue lhs, const CodePoint& rhs);
-bool operator>=(const CodePoint& lhs, CodePointValue rhs);
-bool operator>=(CodePointValue lhs, const CodePoint& rhs);
-bool operator<=(const CodePoint& lhs, CodePointValue rhs);
-bool operator<=(CodePointValue lhs, const CodePoint& rhs);
-bool operator>(const CodePoint& lhs, CodePointValue rhs);
-bool operator>(CodePointValue lhs, const CodePoint& rhs);
-bool operator<(const CodePoint& lhs, CodePointValue rhs);
-bool operator<(CodePointValue lhs, const CodePoint& rhs);
+constexpr CodePoint::CodePoint(CodePointValue value)
+	: m_Value(static_cast<unsigned>(value))
+{
+}
+
+constexpr CodePoint::CodePoint(unsigned value)
+	: m_Value(value)
+{
+}
+
+constexpr unsigned CodePoint::GetBytes() const
+{
+	return m_Value;
+}
+
+inline bool operator==(const CodePoint& lhs, const CodePoint& rhs)
+{
+	return lhs.GetBytes() == rhs.GetBytes();
+}
+
+inline bool operator==(const CodePoint& lhs, unsigned rhs)
+{
+	return lhs.GetBytes() == rhs;
+}
+
+inline bool operator==(unsigned lhs, const CodePoint& rhs)
+{
+	return lhs == rhs.GetBytes();
+}
+
+inline bool operator!=(const CodePoint& lhs, const CodePoint& rhs)
+{
+	return lhs.GetBytes() != rhs.GetBytes();
+}
+
+inline bool operator!=(const CodePoint& lhs, unsigned rhs)
+{
+	return lhs.GetBytes() != rhs;
+}
+
+inline bool operator!=(unsigned lhs, const CodePoint& rhs)
+{
+	return lhs != rhs.GetBytes();
+}
+
+inline bool operator>=(const CodePoint& lhs, const CodePoint& rhs)
+{
+	return lhs.GetBytes() >= rhs.GetBytes();
+}
+
+inline bool operator>=(const CodePoint& lhs, unsigned rhs)
+{
+	return lhs.GetBytes() >= rhs;
+}
+
+inline bool operator>=(unsigned lhs, const CodePoint& rhs)
+{
+	return lhs >= rhs.GetBytes();
+}
+
+inline bool operator<=(const CodePoint& lhs, const CodePoint& rhs)
+{
+	return lhs.GetBytes() <= rhs.GetBytes();
+}
+
+inline bool operator<=(const CodePoint& lhs, unsigned rhs)
+{
+	return lhs.GetBytes() <= rhs;
+}
+
+inline bool operator<=(unsigned lhs, const CodePoint& rhs)
+{
+	return lhs <= rhs.GetBytes();
+}
+
+inline bool operator>(const CodePoint& lhs, const CodePoint& rhs)
+{
+	return lhs.GetBytes() > rhs.GetBytes();
+}
+
+inline bool operator>(const CodePoint& lhs, unsigned rhs)
+{
+	return lhs.GetBytes() > rhs;
+}
+
+inline bool operator>(unsigned lhs, const CodePoint& rhs)
+{
+	return lhs > rhs.GetBytes();
+}
+
+inline bool operator<(const CodePoint& lhs, const CodePoint& rhs)
+{
+	return lhs.GetBytes() < rhs.GetBytes();
+}
+
+inline bool operator<(const CodePoint& lhs, unsigned rhs)
+{
+	return lhs.GetBytes() < rhs;
+}
+
+inline bool operator<(unsigned lhs, const CodePoint& rhs)
+{
+	return lhs < rhs.GetBytes();
+}
+
+inline bool operator==(const CodePoint& lhs, CodePointValue rhs)
+{
+	return lhs.GetBytes() == static_cast<unsigned>(rhs);
+}
+
+inline bool operator==(CodePointValue lhs, const CodePoint& rhs)
+{
+	return static_cast<unsigned>(lhs) == rhs.GetBytes();
+}
+
+inline bool operator!=(const CodePoint& lhs, CodePointValue rhs)
+{
+	return lhs.GetBytes() != static_cast<unsigned>(rhs);
+}
+
+inline bool operator!=(CodePointValue lhs, const CodePoint& rhs)
+{
+	return static_cast<unsigned>(lhs) != rhs.GetBytes();
+}
+
+inline bool operator>=(const CodePoint& lhs, CodePointValue rhs)
+{
+	return lhs.GetBytes() >= static_cast<unsigned>(rhs);
+}
+
+inline bool operator>=(CodePointValue lhs, const CodePoint& rhs)
+{
+	return static_cast<unsigned>(lhs) >= rhs.GetBytes();
+}
+
+inline bool operator<=(const CodePoint& lhs, CodePointValue rhs)
+{
+	return lhs.GetBytes() <= static_cast<unsigned>(rhs);
+}
+
+inline bool operator<=(CodePointValue lhs, const CodePoint& rhs)
+{
+	return static_cast<unsigned>(lhs) <= rhs.GetBytes();
+}
+
+inline bool operator>(const CodePoint& lhs, CodePointValue rhs)
+{
+	return lhs.GetBytes() > static_cast<unsigned>(rhs);
+}
+
+inline bool operator>(CodePointValue lhs, const CodePoint& rhs)
+{
+	return static_cast<unsigned>(lhs) > rhs.GetBytes();
+}
+
+inline bool operator<(const CodePoint& lhs, CodePointValue rhs)
+{
+	return lhs.GetBytes() < static_cast<unsigned>(rhs);
+}
+
+inline bool operator<(CodePointValue lhs, const CodePoint& rhs)
+{
+	return static_cast<unsigned>(lhs) < rhs.GetBytes();
+}
+
+// Bit flags of the character class table, one per code point category the tokenizer asks about.
+struct CharacterClass
+{
+	constexpr static unsigned short WHITESPACE = 1 << 0;
+	constexpr static unsigned short DIGIT = 1 << 1;
+	constexpr static unsigned short HEX_DIGIT = 1 << 2;
+	constexpr static unsigned short UPPERCASE_LETTER = 1 << 3;
+	constexpr static unsigned short LOWERCASE_LETTER = 1 << 4;
+	constexpr static unsigned short NON_ASCII = 1 << 5;
+	constexpr static unsigned short IDENT_START = 1 << 6;
+	constexpr static unsigned short IDENT = 1 << 7;
+	constexpr static unsigned short NON_PRINTABLE = 1 << 8;
+	constexpr static unsigned short LETTER = UPPERCASE_LETTER | LOWERCASE_LETTER;
+	// Every code point from U+0080 to the maximum allowed code point has the same classes.
+	constexpr static unsigned short NON_ASCII_CLASSES = NON_ASCII | IDENT_START | IDENT;
+};
+
+constexpr FixedArray<unsigned short, 256> CreateCharacterClasses()
+{
+	FixedArray<unsigned short, 256> classes{};
+	for (unsigned value = 0; value < classes.size(); ++value)
+	{
+		unsigned short valueClasses = 0;
+		if (value == 0x0A || value == 0x09 || value == 0x20)
+		{
+			valueClasses |= CharacterClass::WHITESPACE;
+		}
+		if (value >= '0' && value <= '9')
+		{
+			valueClasses |= CharacterClass::DIGIT | CharacterClass::HEX_DIGIT | CharacterClass::IDENT;
+		}
+		if ((value >= 'A' && value <= 'F') || (value >= 'a' && value <= 'f'))
+		{
+			valueClasses |= CharacterClass::HEX_DIGIT;
+		}
+		if (value >= 'A' && value <= 'Z')
+		{
+			valueClasses |= CharacterClass::UPPERCASE_LETTER | CharacterClass::IDENT_START | CharacterClass::IDENT;
+		}
+		if (value >= 'a' && value <= 'z')
+		{
+			valueClasses |= CharacterClass::LOWERCASE_LETTER | CharacterClass::IDENT_START | CharacterClass::IDENT;
+		}
+		if (value == '_')
+		{
+			valueClasses |= CharacterClass::IDENT_START | CharacterClass::IDENT;
+		}
+		if (value == '-')
+		{
+			valueClasses |= CharacterClass::IDENT;
+		}
+		if (value <= 0x08 || value == 0x0B || (value >= 0x0E && value <= 0x1F) || value == 0x7F)
+		{
+			valueClasses |= CharacterClass::NON_PRINTABLE;
+		}
+		if (value >= 0x80)
+		{
+			valueClasses |= CharacterClass::NON_ASCII_CLASSES;
+		}
+		classes[value] = valueClasses;
+	}
+	return classes;
+}
+
+// Classes of the code points up to U+00FF. It also classifies raw UTF-8 bytes, every byte of a
+// multi-byte sequence gets the classes of the non-ASCII code point it is part of.
+inline constexpr FixedArray<unsigned short, 256> CHARACTER_CLASSES = CreateCharacterClasses();
+
+inline unsigned short GetCharacterClasses(const CodePoint& codePoint)
+{
+	const unsigned value = codePoint.GetBytes();
+	if (value < 0x80)
+	{
+		return CHARACTER_CLASSES[value];
+	}
+	return value <= static_cast<unsigned>(CodePointValue::MAXIMUM_ALLOWED_CODE_POINT) ? CharacterClass::NON_ASCII_CLASSES : 0;
+}
+
+inline bool HasCharacterClass(const CodePoint& codePoint, unsigned short characterClass)
+{
+	return (GetCharacterClasses(codePoint) & characterClass) != 0;
+}
+
+// https://www.w3.org/TR/css-syntax-3/#eof-code-point
+inline bool IsEOF(const CodePoint& codePoint)
+{
+	return codePoint == CodePointValue::END_OF_FILE;
+}
 
 // A leading surrogate is a code point that is in the range U+D800 to U+DBFF, inclusive.
-bool IsLeadingSurrogate(const CodePoint& codePoint);
+inline bool IsLeadingSurrogate(const CodePoint& codePoint)
+{
+	return codePoint >= 0xD800 && codePoint <= 0xDBFF;
+}
+
 // A trailing surrogate is a code point that is in the range U+DC00 to U+DFFF, inclusive.
-bool IsTrailingSurrogate(const CodePoint& codePoint);
+inline bool IsTrailingSurrogate(const CodePoint& codePoint)
+{
+	return codePoint >= 0xDC00 && codePoint <= 0xDFFF;
+}
+
 // A surrogate is a leading surrogate or a trailing surrogate.
-bool IsSurrogate(const CodePoint& codePoint);
+inline bool IsSurrogate(const CodePoint& codePoint)
+{
+	return codePoint >= 0xD800 && codePoint <= 0xDFFF;
+}
+
 // A scalar value is a code point that is not a surrogate.
-bool IsScalarValue(const CodePoint& codePoint);
+inline bool IsScalarValue(const CodePoint& codePoint)
+{
+	return !IsSurrogate(codePoint);
+}
+
 // https://www.w3.org/TR/css-syntax-3/#newline
-bool IsNewline(const CodePoint& codePoint);
+inline bool IsNewline(const CodePoint& codePoint)
+{
+	return codePoint == CodePointValue::LINE_FEED;
+}
+
 // https://www.w3.org/TR/css-syntax-3/#whitespace
-bool IsWhitespace(const CodePoint& codePoint);
+inline bool IsWhitespace(const CodePoint& codePoint)
+{
+	return HasCharacterClass(codePoint, CharacterClass::WHITESPACE);
+}
+
 // https://www.w3.org/TR/css-syntax-3/#digit
-bool IsDigit(const CodePoint& codePoint);
+inline bool IsDigit(const CodePoint& codePoint)
+{
+	return HasCharacterClass(codePoint, CharacterClass::DIGIT);
+}
+
 // https://www.w3.org/TR/css-syntax-3/#hex-digit
-bool IsHexDigit(const CodePoint& codePoint);
+inline bool IsHexDigit(const CodePoint& codePoint)
+{
+	return HasCharacterClass(codePoint, CharacterClass::HEX_DIGIT);
+}
+
 // https://www.w3.org/TR/css-syntax-3/#uppercase-letter
-bool IsUppercaseLetter(const CodePoint& codePoint);
+inline bool IsUppercaseLetter(const CodePoint& codePoint)
+{
+	return HasCharacterClass(codePoint, CharacterClass::UPPERCASE_LETTER);
+}
+
 // https://www.w3.org/TR/css-syntax-3/#lowercase-letter
-bool IsLowercaseLetter(const CodePoint& codePoint);
+inline bool IsLowercaseLetter(const CodePoint& codePoint)
+{
+	return HasCharacterClass(codePoint, CharacterClass::LOWERCASE_LETTER);
+}
+
 // https://www.w3.org/TR/css-syntax-3/#letter
-bool IsLetter(const CodePoint& codePoint);
+inline bool IsLetter(const CodePoint& codePoint)
+{
+	return HasCharacterClass(codePoint, CharacterClass::LETTER);
+}
+
 // https://www.w3.org/TR/css-syntax-3/#non-ascii-code-point
-bool IsNonASCII(const CodePoint& codePoint);
+inline bool IsNonASCII(const CodePoint& codePoint)
+{
+	return HasCharacterClass(codePoint, CharacterClass::NON_ASCII);
+}
+
 // https://www.w3.org/TR/css-syntax-3/#ident-start-code-point
-bool IsIdentStart(const CodePoint& codePoint);
+inline bool IsIdentStart(const CodePoint& codePoint)
+{
+	return HasCharacterClass(codePoint, CharacterClass::IDENT_START);
+}
+
 // https://www.w3.org/TR/css-syntax-3/#ident-code-point
-bool IsIdent(const CodePoint& codePoint);
+inline bool IsIdent(const CodePoint& codePoint)
+{
+	return HasCharacterClass(codePoint, CharacterClass::IDENT);
+}
+
 // https://www.w3.org/TR/css-syntax-3/#non-printable-code-point
-bool IsNonPrintable(const CodePoint& codePoint);
+inline bool IsNonPrintable(const CodePoint& codePoint)
+{
+	return HasCharacterClass(codePoint, CharacterClass::NON_PRINTABLE);
+}
+
+// https://encoding.spec.whatwg.org/#bom-sniff
+Encoding BOMSniff(const StringView& ioQueue, SizeType position);
+// Decodes the code point whose UTF-8 byte sequence starts at position, with the error handling of
+// https://encoding.spec.whatwg.org/#utf-8-decoder. length receives the number of bytes the decoder consumes.
+// No input preprocessing is done.
+CodePoint DecodeUTF8CodePoint(const StringView& input, SizeType position, SizeType& length);
+// https://encoding.spec.whatwg.org/#utf-8-encoder
+// Appends the UTF-8 byte sequence of codePoint, which is expected to be a scalar value, to output.
+void AppendUTF8(const CodePoint& codePoint, String& output);
+class CodePointBuffer;
+
+// https://encoding.spec.whatwg.org/#utf-8-decoder
+// Decodes UTF-8 bytes into code points and does the input preprocessing
+// (https://www.w3.org/TR/css-syntax-3/#input-preprocessing).
+// The decoder state is kept between calls to Decode, so the input can be fed in chunks
+// that split code points, and CR LF pairs, at any byte.
+class UTF8Decoder
+{
+public:
+	UTF8Decoder();
+	// Appends the code points decoded from the next chunk of input.
+	// Nothing after a U+0000 NULL byte is decoded, it ends the input.
+	void Decode(const StringView& input, Vector<CodePoint>& output);
+	// The same, with the code points stored with the narrowest code units.
+	void Decode(const StringView& input, CodePointBuffer& output);
+	// Ends the input. An incomplete sequence at the end becomes U+FFFD REPLACEMENT CHARACTER.
+	void Finish(Vector<CodePoint>& output);
+	void Finish(CodePointBuffer& output);
+private:
+	template <typename Output>
+	void DecodeInto(const StringView& input, Output& output);
+	template <typename Output>
+	void FinishInto(Output& output);
+
+	unsigned m_CodePoint;
+	// The state of the DFA in CodePoints.cpp, 0 between sequences.
+	unsigned char m_State;
+	bool m_IsPreviousCarriageReturn;
+	bool m_IsFinished;
+};
+// https://encoding.spec.whatwg.org/#shared-utf-16-decoder
+// Decodes UTF-16BE or UTF-16LE bytes into code points and does the input preprocessing, keeping its state
+// between calls to Decode like UTF8Decoder. Lone surrogates become U+FFFD REPLACEMENT CHARACTER.
+// Unlike in UTF-8 input, U+0000 NULL code units do not end the input, they are replaced by the preprocessing.
+class UTF16Decoder
+{
+public:
+	explicit UTF16Decoder(bool isBigEndian);
+	void Decode(const StringView& input, Vector<CodePoint>& output);
+	void Decode(const StringView& input, CodePointBuffer& output);
+	void Finish(Vector<CodePoint>& output);
+	void Finish(CodePointBuffer& output);
+private:
+	template <typename Output>
+	void DecodeInto(const StringView& input, Output& output);
+	template <typename Output>
+	void DecodeCodeUnit(unsigned codeUnit, Output& output);
+	template <typename Output>
+	void FinishInto(Output& output);
+
+	unsigned m_LeadSurrogate;
+	unsigned char m_LeadByte;
+	bool m_HasLeadByte;
+	bool m_IsBigEndian;
+	bool m_IsPreviousCarriageReturn;
+};
+// The number of EOF code points appended after a decoded stream of code points. The tokenizer looks at most
+// three code points ahead, so with them it never has to check whether it has reached the end of the stream.
+constexpr SizeType END_OF_FILE_PADDING = 3;
+// Appends END_OF_FILE_PADDING EOF code points to codePoints.
+void PadWithEndOfFile(Vector<CodePoint>& codePoints);
+
+// https://www.w3.org/TR/css-syntax-3/#input-preprocessing
+// Does the input preprocessing on UTF-8 bytes before they are decoded: U+000D CARRIAGE RETURN (CR) followed by
+// U+000A LINE FEED (LF), CR and U+000C FORM FEED (FF) become LF, and, like for UTF8Decoder, a U+0000 NULL byte
+// ends the input. These are all ASCII, never part of a multi-byte sequence, so decoding the result gives the code
+// points that decoding and preprocessing input would. The runs between them are copied as they are.
+void PreprocessUTF8(const StringView& input, String& output);
+// The same in a buffer owned by the caller. Returns the new size of text, which is left untouched
+// when it needs no preprocessing.
+SizeType PreprocessUTF8InPlace(char* text, SizeType size);
+
 // https://www.w3.org/TR/css-syntax-3/#input-byte-stream
 // When parsing a stylesheet, the stream of Unicode code points that comprises the input to the
 // tokenization stage might be initially seen by the user agent as a stream of bytes
@@ -177,5 +542,46 @@ bool IsNonPrintable(const CodePoint& codePoint);
 // into code points according to a particular character encoding.
 // https://encoding.spec.whatwg.org/#decode
 // Decode stylesheet's stream of bytes with fallback encoding fallback, and return the result.
-bool CreateCodePointsStream(const char* text, unsigned size, Vector<CodePoint>& output);
+// The code points are followed by END_OF_FILE_PADDING EOF code points, as CodePointInputStream expects.
+bool CreateCodePointsStream(const char* text, SizeType size, Vector<CodePoint>& output);
+
+// A decoded stream of code points stored with the narrowest code units that fit all of them: one byte when they are
+// all at most U+00FF, two bytes when they are all at most U+FFFF and four bytes otherwise, which cuts the memory
+// the tokenizer reads by as much for most stylesheets.
+// The code points are decoded straight into the narrowest code units, which are only widened when a code point that
+// does not fit them arrives, so the common inputs are never stored wider.
+// The narrow code units are followed by END_OF_FILE_PADDING code units of 0, which stand for EOF. The input
+// preprocessing replaces U+0000 NULL, so no code point is ever stored as 0.
+class CodePointBuffer
+{
+public:
+	explicit CodePointBuffer(MemoryResource* resource = std::pmr::get_default_resource());
+	// Starts a new input with one-byte code units and no code points. expectedCount is how many code points it is
+	// expected to have, which the code units of any width are reserved for.
+	void Start(SizeType expectedCount);
+	void Append(const CodePoint& codePoint);
+	// Appends count ASCII bytes, or count UTF-16 code units that are not surrogates, as code points.
+	void AppendASCII(const char* text, SizeType count);
+	void AppendUTF16(const char* text, SizeType count, bool isBigEndian);
+	// Ends the input with the EOF padding. Only the code units of its width keep their memory, so a buffer reused
+	// for input after input stops allocating once they are the same width, and never holds more than one copy.
+	void End();
+	// 1, 2 or 4, only the code units of that size are valid.
+	unsigned GetCodeUnitSize() const;
+	const Vector<unsigned char>& GetLatin1() const;
+	const Vector<char16_t>& GetUCS2() const;
+	const Vector<CodePoint>& GetUTF32() const;
+private:
+	// Moves the code points to code units of codeUnitSize, which is wider than the current one.
+	void Widen(unsigned codeUnitSize);
+
+	Vector<unsigned char> m_Latin1;
+	Vector<char16_t> m_UCS2;
+	Vector<CodePoint> m_UTF32;
+	unsigned m_CodeUnitSize;
+	SizeType m_ExpectedCount;
+};
+
+// Like CreateCodePointsStream into a Vector, but stores the code points with the narrowest code units.
+bool CreateCodePointsStream(const char* text, SizeType size, CodePointBuffer& output);
 }
\ No newline at end of file
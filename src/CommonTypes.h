@@ -31,16 +31,21 @@ SOFTWARE.
 #include <vector>
 #include <variant>
 #include <cstddef>
+#include <cstdint>
 #include <array>
+#include <memory_resource>
 
 namespace css_parser
 {
+// The containers take their memory from a std::pmr::memory_resource, by default new and delete.
+// The types that own containers accept a resource, e.g. an arena that frees everything they allocated at once.
+using MemoryResource = std::pmr::memory_resource;
 using Byte = std::byte;
-using String = std::string;
+using String = std::pmr::string;
 using StringView = std::string_view;
 using SizeType = std::size_t;
 template <typename T>
-using Vector = std::vector<T>;
+using Vector = std::pmr::vector<T>;
 template <typename ... Types>
 using Variant = std::variant<Types...>;
 template <typename T, SizeType size>
@@ -0,0 +1,325 @@
+/*
+MIT License
+
+Copyright (c) 2024 omalinov
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#pragma once
+
+#include "CommonTypes.h"
+#include "CodePoints.h"
+#include "CSSParserAssert.h"
+#include "Kernels.h"
+
+#include <algorithm>
+#include <cstring>
+
+namespace css_parser
+{
+// The tokenizer reads its input through a cursor with the interface below, so the same consume algorithms
+// run over an already decoded stream of code points and over the raw UTF-8 bytes.
+//   CodePoint Peek(SizeType offset = 0) const - the code point offset positions after the next input code point,
+//                                               or an EOF code point past the end of the input. offset is
+//                                               at most 2, the tokenizer looks at most three code points ahead
+//   void Advance(SizeType count = 1)          - consumes count code points
+//   SizeType GetPosition() const              - opaque position, usable only with SetPosition
+//   void SetPosition(SizeType position)       - goes back to a position, used to reconsume code points
+//   bool SkipCommentBody()                    - consumes the code points up to and including the next U+002A ASTERISK (*)
+//                                               followed by a U+002F SOLIDUS (/), or returns false after consuming
+//                                               the rest of the input when there is none
+//   void SkipWhitespace()                     - consumes the whitespace ahead
+//   static bool CAN_REFERENCE_INPUT           - whether token values can be ranges of the input, see TokenList.
+//                                               If so, positions are byte offsets in GetInput(), and
+//                                               IsNextCodePointVerbatim() tells whether the bytes of the next
+//                                               code point are its UTF-8 encoding, and SkipStringBody(quote)
+//                                               and SkipIdentRun() consume runs of ASCII bytes that a string
+//                                               token or an ident sequence take as they are
+
+// The code points of a CodePointBuffer or of a Vector<CodePoint>, whichever their code units are.
+inline CodePoint ToCodePoint(unsigned char codeUnit)
+{
+	return codeUnit != 0 ? CodePoint(codeUnit) : CodePoint(CodePointValue::END_OF_FILE);
+}
+
+inline CodePoint ToCodePoint(char16_t codeUnit)
+{
+	return codeUnit != 0 ? CodePoint(codeUnit) : CodePoint(CodePointValue::END_OF_FILE);
+}
+
+inline CodePoint ToCodePoint(const CodePoint& codePoint)
+{
+	return codePoint;
+}
+
+// The kernels for each size of code units.
+inline SizeType ScanWhitespace(const unsigned char* codePoints, SizeType count)
+{
+	return ScanWhitespace(reinterpret_cast<const char*>(codePoints), count);
+}
+
+inline SizeType ScanWhitespace(const CodePoint* codePoints, SizeType count)
+{
+	return ScanWhitespace(reinterpret_cast<const unsigned*>(codePoints), count);
+}
+
+inline SizeType FindCommentEnd(const unsigned char* codePoints, SizeType count)
+{
+	return FindCommentEnd(reinterpret_cast<const char*>(codePoints), count);
+}
+
+inline SizeType FindCommentEnd(const CodePoint* codePoints, SizeType count)
+{
+	return FindCommentEnd(reinterpret_cast<const unsigned*>(codePoints), count);
+}
+
+// Cursor over a stream of code points that has already gone through the input preprocessing, followed by
+// END_OF_FILE_PADDING EOF code points. The position never goes past the last code point, so looking ahead
+// never needs a bounds check.
+// CodeUnit is unsigned char, char16_t or CodePoint, see CodePointBuffer, so each width gets its own tokenizer.
+template <typename CodeUnit>
+class CodePointInputStream
+{
+public:
+	constexpr static bool CAN_REFERENCE_INPUT = false;
+
+	explicit CodePointInputStream(const Vector<CodeUnit>& codePoints)
+		: m_CodePoints(codePoints.data())
+		, m_Size(codePoints.size() - END_OF_FILE_PADDING)
+		, m_Position(0)
+	{
+		CSS_PARSER_ASSERT(codePoints.size() >= END_OF_FILE_PADDING
+			&& IsEOF(ToCodePoint(codePoints.back())), "The code points have to be padded with EOF");
+	}
+
+	CodePoint Peek(SizeType offset = 0) const
+	{
+		CSS_PARSER_ASSERT(offset < END_OF_FILE_PADDING, "Looking further ahead than the padding");
+		return ToCodePoint(m_CodePoints[m_Position + offset]);
+	}
+
+	// Whether anything consumed so far may have depended on looking at the EOF code points, i.e. whether
+	// the position is within the lookahead of the end. When the code points are only a prefix of the input,
+	// anything consumed after that depends on input that has not arrived yet.
+	// Consuming a token never goes back further than the code points it looked ahead at, so this is enough.
+	bool MayHavePeekedPastEnd() const
+	{
+		return m_Position + END_OF_FILE_PADDING > m_Size;
+	}
+
+	void Advance(SizeType count = 1)
+	{
+		m_Position += count;
+		CSS_PARSER_ASSERT(m_Position <= m_Size, "Advancing past the last code point");
+	}
+
+	SizeType GetPosition() const
+	{
+		return m_Position;
+	}
+
+	void SetPosition(SizeType position)
+	{
+		m_Position = position;
+	}
+
+	bool SkipCommentBody()
+	{
+		const SizeType count = m_Size - m_Position;
+		const SizeType end = FindCommentEnd(m_CodePoints + m_Position, count);
+		if (end == count)
+		{
+			m_Position = m_Size;
+			return false;
+		}
+		m_Position += end + 2;
+		return true;
+	}
+
+	void SkipWhitespace()
+	{
+		m_Position += ScanWhitespace(m_CodePoints + m_Position, m_Size - m_Position);
+	}
+private:
+	const CodeUnit* m_CodePoints;
+	SizeType m_Size;
+	SizeType m_Position;
+};
+
+// Cursor over UTF-8 encoded bytes. Code points are decoded and preprocessed
+// (https://www.w3.org/TR/css-syntax-3/#input-preprocessing) one at a time as the tokenizer reaches them,
+// so no decoded copy of the input is ever created.
+// The input ends at the first U+0000 NULL byte, like it does for UTF8Decode. It is found as the tokenizer reaches it
+// instead of by scanning the whole input up front, the scan kernels stop at it like at any other byte that needs
+// a closer look. A leading UTF-8 BOM is skipped, like https://encoding.spec.whatwg.org/#decode removes it, while
+// positions stay byte offsets in text.
+class UTF8InputStream
+{
+public:
+	constexpr static bool CAN_REFERENCE_INPUT = true;
+
+	UTF8InputStream(const char* text, SizeType size)
+		: m_Input(text, size)
+		, m_Position(0)
+	{
+		if (BOMSniff(m_Input, 0) == Encoding::UTF8)
+		{
+			m_Position = 3;
+		}
+	}
+
+	CodePoint Peek(SizeType offset = 0) const
+	{
+		SizeType position = m_Position;
+		SizeType length = 0;
+		for (; offset > 0; --offset)
+		{
+			if (IsEnd(position))
+			{
+				return CodePoint(CodePointValue::END_OF_FILE);
+			}
+			Decode(position, length);
+			position += length;
+		}
+		if (IsEnd(position))
+		{
+			return CodePoint(CodePointValue::END_OF_FILE);
+		}
+		return Decode(position, length);
+	}
+
+	// False when the next input code point was changed by the input preprocessing,
+	// or replaces an invalid byte sequence.
+	bool IsNextCodePointVerbatim() const
+	{
+		if (IsEnd(m_Position))
+		{
+			return false;
+		}
+		const unsigned char byte = static_cast<unsigned char>(m_Input[m_Position]);
+		if (byte < 0x80)
+		{
+			return byte != '\r' && byte != '\f';
+		}
+		SizeType length = 0;
+		const CodePoint codePoint = DecodeUTF8CodePoint(m_Input, m_Position, length);
+		// An encoded U+FFFD REPLACEMENT CHARACTER is the only 3 byte sequence starting with 0xEF that decodes to it.
+		return codePoint != CodePointValue::REPLACEMENT || (length == 3 && byte == 0xEF);
+	}
+
+	void Advance(SizeType count = 1)
+	{
+		SizeType length = 0;
+		for (; count > 0 && !IsEnd(m_Position); --count)
+		{
+			Decode(m_Position, length);
+			m_Position += length;
+		}
+	}
+
+	SizeType GetPosition() const
+	{
+		return m_Position;
+	}
+
+	void SetPosition(SizeType position)
+	{
+		m_Position = position;
+	}
+
+	bool SkipCommentBody()
+	{
+		const SizeType end = m_Position + FindCommentEnd(m_Input.data() + m_Position, m_Input.size() - m_Position);
+		// FindCommentEnd does not stop at a U+0000 NULL byte, so the bytes it went over are checked for one.
+		const void* null = std::memchr(m_Input.data() + m_Position, '\0', end - m_Position);
+		if (null)
+		{
+			m_Position = static_cast<const char*>(null) - m_Input.data();
+			return false;
+		}
+		if (end == m_Input.size())
+		{
+			m_Position = m_Input.size();
+			return false;
+		}
+		m_Position = end + 2;
+		return true;
+	}
+
+	// The kernels of this, SkipIdentRun and SkipStringBody stop at a U+0000 NULL byte like at any byte they do not take.
+	void SkipWhitespace()
+	{
+		m_Position += ScanWhitespace(m_Input.data() + m_Position, m_Input.size() - m_Position);
+	}
+
+	SizeType SkipIdentRun()
+	{
+		const SizeType length = ScanIdent(m_Input.data() + m_Position, m_Input.size() - m_Position);
+		m_Position += length;
+		return length;
+	}
+
+	// Consumes the bytes of a string body up to the next one that needs the attention of ConsumeStringToken.
+	// Returns the number of bytes consumed, which are also the code points consumed.
+	SizeType SkipStringBody(char quote)
+	{
+		const SizeType length = ScanStringBody(m_Input.data() + m_Position, m_Input.size() - m_Position, quote);
+		m_Position += length;
+		return length;
+	}
+
+	// All of text, including what comes after a U+0000 NULL byte that ends the input.
+	StringView GetInput() const
+	{
+		return m_Input;
+	}
+private:
+	bool IsEnd(SizeType position) const
+	{
+		return position >= m_Input.size() || m_Input[position] == '\0';
+	}
+
+	CodePoint Decode(SizeType position, SizeType& length) const
+	{
+		const unsigned char byte = static_cast<unsigned char>(m_Input[position]);
+		if (byte >= 0x80)
+		{
+			return DecodeUTF8CodePoint(m_Input, position, length);
+		}
+		length = 1;
+		if (byte == '\r')
+		{
+			if (position + 1 < m_Input.size() && m_Input[position + 1] == '\n')
+			{
+				length = 2;
+			}
+			return CodePoint(CodePointValue::LINE_FEED);
+		}
+		if (byte == '\f')
+		{
+			return CodePoint(CodePointValue::LINE_FEED);
+		}
+		return CodePoint(byte);
+	}
+
+	StringView m_Input;
+	SizeType m_Position;
+};
+}
@@ -0,0 +1,1088 @@
+/*
+MIT License
+
+Copyright (c) 2024 omalinov
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#include "Kernels.h"
+#include "CodePoints.h"
+#include "CSSParser/CSSParser.h"
+
+#include <atomic>
+#include <cstring>
+
+#if defined(_M_X64) || defined(_M_AMD64) || defined(_M_IX86) || defined(__x86_64__) || defined(__i386__)
+#define CSS_PARSER_X86 1
+#include <immintrin.h>
+#if defined(_MSC_VER)
+#include <intrin.h>
+#else
+#include <cpuid.h>
+#endif
+#endif
+
+// Every kernel is compiled for every instruction set whatever the compiler options, and the widest one the CPU
+// supports is selected at runtime, so a single build runs well on every host.
+#if defined(_MSC_VER) && !defined(__clang__)
+// MSVC accepts the intrinsics of any instruction set in any function.
+#define CSS_PARSER_TARGET_SSE2
+#define CSS_PARSER_TARGET_AVX2
+#define CSS_PARSER_TARGET_AVX512
+#else
+#define CSS_PARSER_TARGET_SSE2 __attribute__((target("sse2")))
+#define CSS_PARSER_TARGET_AVX2 __attribute__((target("avx2")))
+#define CSS_PARSER_TARGET_AVX512 __attribute__((target("avx2,avx512f,avx512bw")))
+#endif
+
+namespace css_parser
+{
+namespace
+{
+unsigned CountTrailingZeros(unsigned mask)
+{
+#if defined(_MSC_VER)
+	unsigned long index = 0;
+	_BitScanForward(&index, mask);
+	return static_cast<unsigned>(index);
+#else
+	return static_cast<unsigned>(__builtin_ctz(mask));
+#endif
+}
+
+unsigned CountTrailingZeros64(uint64_t mask)
+{
+	const unsigned low = static_cast<unsigned>(mask);
+	return low != 0 ? CountTrailingZeros(low) : 32 + CountTrailingZeros(static_cast<unsigned>(mask >> 32));
+}
+
+bool IsPlainASCII(unsigned char byte)
+{
+	return byte < 0x80 && byte != '\r' && byte != '\f' && byte != '\0';
+}
+
+unsigned ReadCodeUnit(const char* text, SizeType index, bool isBigEndian)
+{
+	const unsigned first = static_cast<unsigned char>(text[2 * index]);
+	const unsigned second = static_cast<unsigned char>(text[2 * index + 1]);
+	return isBigEndian ? (first << 8) | second : (second << 8) | first;
+}
+
+bool IsRawWhitespace(unsigned char byte)
+{
+	return byte == ' ' || byte == '\t' || byte == '\n' || byte == '\r' || byte == '\f';
+}
+
+bool IsPlainCodeUnit(unsigned codeUnit)
+{
+	return (codeUnit & 0xF800) != 0xD800 && codeUnit != '\r' && codeUnit != '\f' && codeUnit != 0;
+}
+
+// The scalar kernels, they also finish the input the vectorized ones leave.
+
+SizeType ScanPlainASCIIScalar(const char* text, SizeType size)
+{
+	SizeType position = 0;
+	while (position < size && IsPlainASCII(static_cast<unsigned char>(text[position])))
+	{
+		++position;
+	}
+	return position;
+}
+
+SizeType FindPreprocessedByteScalar(const char* text, SizeType size)
+{
+	SizeType position = 0;
+	while (position < size && text[position] != '\r' && text[position] != '\f' && text[position] != '\0')
+	{
+		++position;
+	}
+	return position;
+}
+
+SizeType CountUTF8LeadBytesScalar(const char* text, SizeType size)
+{
+	SizeType count = 0;
+	for (SizeType position = 0; position < size; ++position)
+	{
+		count += (static_cast<unsigned char>(text[position]) & 0xC0) != 0x80;
+	}
+	return count;
+}
+
+void WidenASCIIScalar(const char* text, SizeType size, unsigned* output)
+{
+	for (SizeType position = 0; position < size; ++position)
+	{
+		output[position] = static_cast<unsigned char>(text[position]);
+	}
+}
+
+SizeType ScanPlainUTF16Scalar(const char* text, SizeType count, bool isBigEndian)
+{
+	SizeType position = 0;
+	while (position < count && IsPlainCodeUnit(ReadCodeUnit(text, position, isBigEndian)))
+	{
+		++position;
+	}
+	return position;
+}
+
+void WidenUTF16Scalar(const char* text, SizeType count, bool isBigEndian, unsigned* output)
+{
+	for (SizeType position = 0; position < count; ++position)
+	{
+		output[position] = ReadCodeUnit(text, position, isBigEndian);
+	}
+}
+
+SizeType ScanStringBodyScalar(const char* text, SizeType size, char quote)
+{
+	SizeType position = 0;
+	for (; position < size; ++position)
+	{
+		const char byte = text[position];
+		if (!IsPlainASCII(static_cast<unsigned char>(byte)) || byte == quote || byte == '\\' || byte == '\n')
+		{
+			break;
+		}
+	}
+	return position;
+}
+
+SizeType ScanWhitespaceScalar(const char* text, SizeType size)
+{
+	SizeType position = 0;
+	while (position < size && IsRawWhitespace(static_cast<unsigned char>(text[position])))
+	{
+		++position;
+	}
+	return position;
+}
+
+SizeType ScanCodePointWhitespaceScalar(const unsigned* codePoints, SizeType count)
+{
+	SizeType position = 0;
+	while (position < count && codePoints[position] < 0x80 && IsRawWhitespace(static_cast<unsigned char>(codePoints[position])))
+	{
+		++position;
+	}
+	return position;
+}
+
+SizeType ScanUCS2WhitespaceScalar(const char16_t* codePoints, SizeType count)
+{
+	SizeType position = 0;
+	while (position < count && codePoints[position] < 0x80 && IsRawWhitespace(static_cast<unsigned char>(codePoints[position])))
+	{
+		++position;
+	}
+	return position;
+}
+
+SizeType ScanIdentScalar(const char* text, SizeType size)
+{
+	SizeType position = 0;
+	for (; position < size; ++position)
+	{
+		const unsigned char byte = static_cast<unsigned char>(text[position]);
+		if (byte >= 0x80 || !(CHARACTER_CLASSES[byte] & CharacterClass::IDENT))
+		{
+			break;
+		}
+	}
+	return position;
+}
+
+SizeType FindCommentEndScalar(const char* text, SizeType size)
+{
+	// memchr is vectorized by the C library.
+	SizeType position = 0;
+	while (position + 1 < size)
+	{
+		const void* asterisk = std::memchr(text + position, '*', size - position - 1);
+		if (!asterisk)
+		{
+			break;
+		}
+		position = static_cast<const char*>(asterisk) - text;
+		if (text[position + 1] == '/')
+		{
+			return position;
+		}
+		++position;
+	}
+	return size;
+}
+
+SizeType FindCodePointCommentEndScalar(const unsigned* codePoints, SizeType count)
+{
+	for (SizeType position = 0; position + 1 < count; ++position)
+	{
+		if (codePoints[position] == '*' && codePoints[position + 1] == '/')
+		{
+			return position;
+		}
+	}
+	return count;
+}
+
+SizeType FindUCS2CommentEndScalar(const char16_t* codePoints, SizeType count)
+{
+	for (SizeType position = 0; position + 1 < count; ++position)
+	{
+		if (codePoints[position] == '*' && codePoints[position + 1] == '/')
+		{
+			return position;
+		}
+	}
+	return count;
+}
+
+#if CSS_PARSER_X86
+CSS_PARSER_TARGET_SSE2 __m128i LoadCodeUnits(const char* text, bool isBigEndian)
+{
+	const __m128i codeUnits = _mm_loadu_si128(reinterpret_cast<const __m128i*>(text));
+	if (!isBigEndian)
+	{
+		return codeUnits;
+	}
+	return _mm_or_si128(_mm_slli_epi16(codeUnits, 8), _mm_srli_epi16(codeUnits, 8));
+}
+
+CSS_PARSER_TARGET_SSE2 SizeType ScanPlainASCIISSE2(const char* text, SizeType size)
+{
+	const __m128i carriageReturn = _mm_set1_epi8('\r');
+	const __m128i formFeed = _mm_set1_epi8('\f');
+	const __m128i null = _mm_setzero_si128();
+	SizeType position = 0;
+	for (; position + 16 <= size; position += 16)
+	{
+		const __m128i chunk = _mm_loadu_si128(reinterpret_cast<const __m128i*>(text + position));
+		const __m128i special = _mm_or_si128(
+			_mm_or_si128(_mm_cmpeq_epi8(chunk, carriageReturn), _mm_cmpeq_epi8(chunk, formFeed)),
+			_mm_cmpeq_epi8(chunk, null));
+		// Non-ASCII bytes already have their high bit set, the special ones are all ones after the comparison.
+		const unsigned mask = static_cast<unsigned>(_mm_movemask_epi8(_mm_or_si128(chunk, special)));
+		if (mask != 0)
+		{
+			return position + CountTrailingZeros(mask);
+		}
+	}
+	return position + ScanPlainASCIIScalar(text + position, size - position);
+}
+
+CSS_PARSER_TARGET_SSE2 SizeType FindPreprocessedByteSSE2(const char* text, SizeType size)
+{
+	const __m128i carriageReturn = _mm_set1_epi8('\r');
+	const __m128i formFeed = _mm_set1_epi8('\f');
+	const __m128i null = _mm_setzero_si128();
+	SizeType position = 0;
+	for (; position + 16 <= size; position += 16)
+	{
+		const __m128i chunk = _mm_loadu_si128(reinterpret_cast<const __m128i*>(text + position));
+		const __m128i special = _mm_or_si128(
+			_mm_or_si128(_mm_cmpeq_epi8(chunk, carriageReturn), _mm_cmpeq_epi8(chunk, formFeed)),
+			_mm_cmpeq_epi8(chunk, null));
+		const unsigned mask = static_cast<unsigned>(_mm_movemask_epi8(special));
+		if (mask != 0)
+		{
+			return position + CountTrailingZeros(mask);
+		}
+	}
+	return position + FindPreprocessedByteScalar(text + position, size - position);
+}
+
+// The CountUTF8LeadBytes kernels subtract the all ones comparison results from per-byte counters, which are summed
+// before any of them can overflow. As signed bytes, the continuation bytes are -128 to -65.
+CSS_PARSER_TARGET_SSE2 SizeType CountUTF8LeadBytesSSE2(const char* text, SizeType size)
+{
+	const __m128i lastContinuationByte = _mm_set1_epi8(-65);
+	SizeType count = 0;
+	SizeType position = 0;
+	while (position + 16 <= size)
+	{
+		__m128i counters = _mm_setzero_si128();
+		for (unsigned i = 0; i < 255 && position + 16 <= size; ++i, position += 16)
+		{
+			const __m128i chunk = _mm_loadu_si128(reinterpret_cast<const __m128i*>(text + position));
+			counters = _mm_sub_epi8(counters, _mm_cmpgt_epi8(chunk, lastContinuationByte));
+		}
+		const __m128i sums = _mm_sad_epu8(counters, _mm_setzero_si128());
+		count += static_cast<SizeType>(_mm_cvtsi128_si32(sums)) + static_cast<SizeType>(_mm_extract_epi16(sums, 4));
+	}
+	return count + CountUTF8LeadBytesScalar(text + position, size - position);
+}
+
+CSS_PARSER_TARGET_SSE2 void WidenASCIISSE2(const char* text, SizeType size, unsigned* output)
+{
+	const __m128i zero = _mm_setzero_si128();
+	SizeType position = 0;
+	for (; position + 16 <= size; position += 16)
+	{
+		const __m128i chunk = _mm_loadu_si128(reinterpret_cast<const __m128i*>(text + position));
+		const __m128i low = _mm_unpacklo_epi8(chunk, zero);
+		const __m128i high = _mm_unpackhi_epi8(chunk, zero);
+		__m128i* destination = reinterpret_cast<__m128i*>(output + position);
+		_mm_storeu_si128(destination, _mm_unpacklo_epi16(low, zero));
+		_mm_storeu_si128(destination + 1, _mm_unpackhi_epi16(low, zero));
+		_mm_storeu_si128(destination + 2, _mm_unpacklo_epi16(high, zero));
+		_mm_storeu_si128(destination + 3, _mm_unpackhi_epi16(high, zero));
+	}
+	WidenASCIIScalar(text + position, size - position, output + position);
+}
+
+CSS_PARSER_TARGET_SSE2 SizeType ScanPlainUTF16SSE2(const char* text, SizeType count, bool isBigEndian)
+{
+	const __m128i surrogateMask = _mm_set1_epi16(static_cast<short>(0xF800));
+	const __m128i surrogate = _mm_set1_epi16(static_cast<short>(0xD800));
+	const __m128i carriageReturn = _mm_set1_epi16('\r');
+	const __m128i formFeed = _mm_set1_epi16('\f');
+	const __m128i null = _mm_setzero_si128();
+	SizeType position = 0;
+	for (; position + 8 <= count; position += 8)
+	{
+		const __m128i chunk = LoadCodeUnits(text + 2 * position, isBigEndian);
+		const __m128i special = _mm_or_si128(
+			_mm_or_si128(_mm_cmpeq_epi16(_mm_and_si128(chunk, surrogateMask), surrogate), _mm_cmpeq_epi16(chunk, null)),
+			_mm_or_si128(_mm_cmpeq_epi16(chunk, carriageReturn), _mm_cmpeq_epi16(chunk, formFeed)));
+		const unsigned mask = static_cast<unsigned>(_mm_movemask_epi8(special));
+		if (mask != 0)
+		{
+			// Every code unit sets two bits of the mask.
+			return position + CountTrailingZeros(mask) / 2;
+		}
+	}
+	return position + ScanPlainUTF16Scalar(text + 2 * position, count - position, isBigEndian);
+}
+
+CSS_PARSER_TARGET_SSE2 void WidenUTF16SSE2(const char* text, SizeType count, bool isBigEndian, unsigned* output)
+{
+	const __m128i zero = _mm_setzero_si128();
+	SizeType position = 0;
+	for (; position + 8 <= count; position += 8)
+	{
+		const __m128i chunk = LoadCodeUnits(text + 2 * position, isBigEndian);
+		__m128i* destination = reinterpret_cast<__m128i*>(output + position);
+		_mm_storeu_si128(destination, _mm_unpacklo_epi16(chunk, zero));
+		_mm_storeu_si128(destination + 1, _mm_unpackhi_epi16(chunk, zero));
+	}
+	WidenUTF16Scalar(text + 2 * position, count - position, isBigEndian, output + position);
+}
+
+CSS_PARSER_TARGET_SSE2 SizeType ScanStringBodySSE2(const char* text, SizeType size, char quote)
+{
+	const __m128i ending = _mm_set1_epi8(quote);
+	const __m128i reverseSolidus = _mm_set1_epi8('\\');
+	const __m128i lineFeed = _mm_set1_epi8('\n');
+	const __m128i carriageReturn = _mm_set1_epi8('\r');
+	const __m128i formFeed = _mm_set1_epi8('\f');
+	const __m128i null = _mm_setzero_si128();
+	SizeType position = 0;
+	for (; position + 16 <= size; position += 16)
+	{
+		const __m128i chunk = _mm_loadu_si128(reinterpret_cast<const __m128i*>(text + position));
+		const __m128i special = _mm_or_si128(
+			_mm_or_si128(
+				_mm_or_si128(_mm_cmpeq_epi8(chunk, ending), _mm_cmpeq_epi8(chunk, reverseSolidus)),
+				_mm_or_si128(_mm_cmpeq_epi8(chunk, lineFeed), _mm_cmpeq_epi8(chunk, carriageReturn))),
+			_mm_or_si128(_mm_cmpeq_epi8(chunk, formFeed), _mm_cmpeq_epi8(chunk, null)));
+		const unsigned mask = static_cast<unsigned>(_mm_movemask_epi8(_mm_or_si128(chunk, special)));
+		if (mask != 0)
+		{
+			return position + CountTrailingZeros(mask);
+		}
+	}
+	return position + ScanStringBodyScalar(text + position, size - position, quote);
+}
+
+CSS_PARSER_TARGET_SSE2 SizeType ScanWhitespaceSSE2(const char* text, SizeType size)
+{
+	const __m128i space = _mm_set1_epi8(' ');
+	const __m128i tabulation = _mm_set1_epi8('\t');
+	const __m128i lineFeed = _mm_set1_epi8('\n');
+	const __m128i carriageReturn = _mm_set1_epi8('\r');
+	const __m128i formFeed = _mm_set1_epi8('\f');
+	SizeType position = 0;
+	for (; position + 16 <= size; position += 16)
+	{
+		const __m128i chunk = _mm_loadu_si128(reinterpret_cast<const __m128i*>(text + position));
+		const __m128i whitespace = _mm_or_si128(
+			_mm_or_si128(_mm_cmpeq_epi8(chunk, space), _mm_cmpeq_epi8(chunk, tabulation)),
+			_mm_or_si128(
+				_mm_or_si128(_mm_cmpeq_epi8(chunk, lineFeed), _mm_cmpeq_epi8(chunk, carriageReturn)),
+				_mm_cmpeq_epi8(chunk, formFeed)));
+		const unsigned mask = ~static_cast<unsigned>(_mm_movemask_epi8(whitespace)) & 0xFFFF;
+		if (mask != 0)
+		{
+			return position + CountTrailingZeros(mask);
+		}
+	}
+	return position + ScanWhitespaceScalar(text + position, size - position);
+}
+
+CSS_PARSER_TARGET_SSE2 SizeType ScanCodePointWhitespaceSSE2(const unsigned* codePoints, SizeType count)
+{
+	const __m128i space = _mm_set1_epi32(' ');
+	const __m128i tabulation = _mm_set1_epi32('\t');
+	const __m128i lineFeed = _mm_set1_epi32('\n');
+	const __m128i carriageReturn = _mm_set1_epi32('\r');
+	const __m128i formFeed = _mm_set1_epi32('\f');
+	SizeType position = 0;
+	for (; position + 4 <= count; position += 4)
+	{
+		const __m128i chunk = _mm_loadu_si128(reinterpret_cast<const __m128i*>(codePoints + position));
+		const __m128i whitespace = _mm_or_si128(
+			_mm_or_si128(_mm_cmpeq_epi32(chunk, space), _mm_cmpeq_epi32(chunk, tabulation)),
+			_mm_or_si128(
+				_mm_or_si128(_mm_cmpeq_epi32(chunk, lineFeed), _mm_cmpeq_epi32(chunk, carriageReturn)),
+				_mm_cmpeq_epi32(chunk, formFeed)));
+		const unsigned mask = ~static_cast<unsigned>(_mm_movemask_epi8(whitespace)) & 0xFFFF;
+		if (mask != 0)
+		{
+			// Every code point sets four bits of the mask.
+			return position + CountTrailingZeros(mask) / 4;
+		}
+	}
+	return position + ScanCodePointWhitespaceScalar(codePoints + position, count - position);
+}
+
+CSS_PARSER_TARGET_SSE2 SizeType ScanUCS2WhitespaceSSE2(const char16_t* codePoints, SizeType count)
+{
+	const __m128i space = _mm_set1_epi16(' ');
+	const __m128i tabulation = _mm_set1_epi16('\t');
+	const __m128i lineFeed = _mm_set1_epi16('\n');
+	const __m128i carriageReturn = _mm_set1_epi16('\r');
+	const __m128i formFeed = _mm_set1_epi16('\f');
+	SizeType position = 0;
+	for (; position + 8 <= count; position += 8)
+	{
+		const __m128i chunk = _mm_loadu_si128(reinterpret_cast<const __m128i*>(codePoints + position));
+		const __m128i whitespace = _mm_or_si128(
+			_mm_or_si128(_mm_cmpeq_epi16(chunk, space), _mm_cmpeq_epi16(chunk, tabulation)),
+			_mm_or_si128(
+				_mm_or_si128(_mm_cmpeq_epi16(chunk, lineFeed), _mm_cmpeq_epi16(chunk, carriageReturn)),
+				_mm_cmpeq_epi16(chunk, formFeed)));
+		const unsigned mask = ~static_cast<unsigned>(_mm_movemask_epi8(whitespace)) & 0xFFFF;
+		if (mask != 0)
+		{
+			return position + CountTrailingZeros(mask) / 2;
+		}
+	}
+	return position + ScanUCS2WhitespaceScalar(codePoints + position, count - position);
+}
+
+// Non-ASCII bytes are negative as signed bytes, so they are never within the ranges compared by the ScanIdent kernels.
+CSS_PARSER_TARGET_SSE2 SizeType ScanIdentSSE2(const char* text, SizeType size)
+{
+	const __m128i lowercaseBit = _mm_set1_epi8(0x20);
+	const __m128i beforeA = _mm_set1_epi8('a' - 1);
+	const __m128i afterZ = _mm_set1_epi8('z' + 1);
+	const __m128i beforeZero = _mm_set1_epi8('0' - 1);
+	const __m128i afterNine = _mm_set1_epi8('9' + 1);
+	const __m128i lowLine = _mm_set1_epi8('_');
+	const __m128i hyphenMinus = _mm_set1_epi8('-');
+	SizeType position = 0;
+	for (; position + 16 <= size; position += 16)
+	{
+		const __m128i chunk = _mm_loadu_si128(reinterpret_cast<const __m128i*>(text + position));
+		const __m128i lowercase = _mm_or_si128(chunk, lowercaseBit);
+		const __m128i letter = _mm_and_si128(_mm_cmpgt_epi8(lowercase, beforeA), _mm_cmplt_epi8(lowercase, afterZ));
+		const __m128i digit = _mm_and_si128(_mm_cmpgt_epi8(chunk, beforeZero), _mm_cmplt_epi8(chunk, afterNine));
+		const __m128i ident = _mm_or_si128(
+			_mm_or_si128(letter, digit),
+			_mm_or_si128(_mm_cmpeq_epi8(chunk, lowLine), _mm_cmpeq_epi8(chunk, hyphenMinus)));
+		const unsigned mask = ~static_cast<unsigned>(_mm_movemask_epi8(ident)) & 0xFFFF;
+		if (mask != 0)
+		{
+			return position + CountTrailingZeros(mask);
+		}
+	}
+	return position + ScanIdentScalar(text + position, size - position);
+}
+
+// Every chunk is compared with U+002A ASTERISK (*) and the chunk one element further with U+002F SOLIDUS (/)
+// by the FindCommentEnd kernels, so a pair is found wherever it is, including across two chunks.
+CSS_PARSER_TARGET_SSE2 SizeType FindCommentEndSSE2(const char* text, SizeType size)
+{
+	const __m128i asterisk = _mm_set1_epi8('*');
+	const __m128i solidus = _mm_set1_epi8('/');
+	SizeType position = 0;
+	for (; position + 17 <= size; position += 16)
+	{
+		const __m128i chunk = _mm_loadu_si128(reinterpret_cast<const __m128i*>(text + position));
+		const __m128i next = _mm_loadu_si128(reinterpret_cast<const __m128i*>(text + position + 1));
+		const unsigned mask = static_cast<unsigned>(_mm_movemask_epi8(
+			_mm_and_si128(_mm_cmpeq_epi8(chunk, asterisk), _mm_cmpeq_epi8(next, solidus))));
+		if (mask != 0)
+		{
+			return position + CountTrailingZeros(mask);
+		}
+	}
+	return position + FindCommentEndScalar(text + position, size - position);
+}
+
+CSS_PARSER_TARGET_SSE2 SizeType FindCodePointCommentEndSSE2(const unsigned* codePoints, SizeType count)
+{
+	const __m128i asterisk = _mm_set1_epi32('*');
+	const __m128i solidus = _mm_set1_epi32('/');
+	SizeType position = 0;
+	for (; position + 5 <= count; position += 4)
+	{
+		const __m128i chunk = _mm_loadu_si128(reinterpret_cast<const __m128i*>(codePoints + position));
+		const __m128i next = _mm_loadu_si128(reinterpret_cast<const __m128i*>(codePoints + position + 1));
+		const unsigned mask = static_cast<unsigned>(_mm_movemask_epi8(
+			_mm_and_si128(_mm_cmpeq_epi32(chunk, asterisk), _mm_cmpeq_epi32(next, solidus))));
+		if (mask != 0)
+		{
+			return position + CountTrailingZeros(mask) / 4;
+		}
+	}
+	return position + FindCodePointCommentEndScalar(codePoints + position, count - position);
+}
+
+CSS_PARSER_TARGET_SSE2 SizeType FindUCS2CommentEndSSE2(const char16_t* codePoints, SizeType count)
+{
+	const __m128i asterisk = _mm_set1_epi16('*');
+	const __m128i solidus = _mm_set1_epi16('/');
+	SizeType position = 0;
+	for (; position + 9 <= count; position += 8)
+	{
+		const __m128i chunk = _mm_loadu_si128(reinterpret_cast<const __m128i*>(codePoints + position));
+		const __m128i next = _mm_loadu_si128(reinterpret_cast<const __m128i*>(codePoints + position + 1));
+		const unsigned mask = static_cast<unsigned>(_mm_movemask_epi8(
+			_mm_and_si128(_mm_cmpeq_epi16(chunk, asterisk), _mm_cmpeq_epi16(next, solidus))));
+		if (mask != 0)
+		{
+			return position + CountTrailingZeros(mask) / 2;
+		}
+	}
+	return position + FindUCS2CommentEndScalar(codePoints + position, count - position);
+}
+
+CSS_PARSER_TARGET_AVX2 SizeType ScanPlainASCIIAVX2(const char* text, SizeType size)
+{
+	const __m256i carriageReturn = _mm256_set1_epi8('\r');
+	const __m256i formFeed = _mm256_set1_epi8('\f');
+	const __m256i null = _mm256_setzero_si256();
+	SizeType position = 0;
+	for (; position + 32 <= size; position += 32)
+	{
+		const __m256i chunk = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(text + position));
+		const __m256i special = _mm256_or_si256(
+			_mm256_or_si256(_mm256_cmpeq_epi8(chunk, carriageReturn), _mm256_cmpeq_epi8(chunk, formFeed)),
+			_mm256_cmpeq_epi8(chunk, null));
+		const unsigned mask = static_cast<unsigned>(_mm256_movemask_epi8(_mm256_or_si256(chunk, special)));
+		if (mask != 0)
+		{
+			return position + CountTrailingZeros(mask);
+		}
+	}
+	return position + ScanPlainASCIISSE2(text + position, size - position);
+}
+
+CSS_PARSER_TARGET_AVX2 SizeType FindPreprocessedByteAVX2(const char* text, SizeType size)
+{
+	const __m256i carriageReturn = _mm256_set1_epi8('\r');
+	const __m256i formFeed = _mm256_set1_epi8('\f');
+	const __m256i null = _mm256_setzero_si256();
+	SizeType position = 0;
+	for (; position + 32 <= size; position += 32)
+	{
+		const __m256i chunk = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(text + position));
+		const __m256i special = _mm256_or_si256(
+			_mm256_or_si256(_mm256_cmpeq_epi8(chunk, carriageReturn), _mm256_cmpeq_epi8(chunk, formFeed)),
+			_mm256_cmpeq_epi8(chunk, null));
+		const unsigned mask = static_cast<unsigned>(_mm256_movemask_epi8(special));
+		if (mask != 0)
+		{
+			return position + CountTrailingZeros(mask);
+		}
+	}
+	return position + FindPreprocessedByteSSE2(text + position, size - position);
+}
+
+CSS_PARSER_TARGET_AVX2 SizeType CountUTF8LeadBytesAVX2(const char* text, SizeType size)
+{
+	const __m256i lastContinuationByte = _mm256_set1_epi8(-65);
+	SizeType count = 0;
+	SizeType position = 0;
+	while (position + 32 <= size)
+	{
+		__m256i counters = _mm256_setzero_si256();
+		for (unsigned i = 0; i < 255 && position + 32 <= size; ++i, position += 32)
+		{
+			const __m256i chunk = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(text + position));
+			counters = _mm256_sub_epi8(counters, _mm256_cmpgt_epi8(chunk, lastContinuationByte));
+		}
+		const __m256i sums = _mm256_sad_epu8(counters, _mm256_setzero_si256());
+		count += static_cast<SizeType>(_mm256_extract_epi16(sums, 0)) + static_cast<SizeType>(_mm256_extract_epi16(sums, 4))
+			+ static_cast<SizeType>(_mm256_extract_epi16(sums, 8)) + static_cast<SizeType>(_mm256_extract_epi16(sums, 12));
+	}
+	return count + CountUTF8LeadBytesSSE2(text + position, size - position);
+}
+
+CSS_PARSER_TARGET_AVX2 SizeType ScanStringBodyAVX2(const char* text, SizeType size, char quote)
+{
+	const __m256i ending = _mm256_set1_epi8(quote);
+	const __m256i reverseSolidus = _mm256_set1_epi8('\\');
+	const __m256i lineFeed = _mm256_set1_epi8('\n');
+	const __m256i carriageReturn = _mm256_set1_epi8('\r');
+	const __m256i formFeed = _mm256_set1_epi8('\f');
+	const __m256i null = _mm256_setzero_si256();
+	SizeType position = 0;
+	for (; position + 32 <= size; position += 32)
+	{
+		const __m256i chunk = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(text + position));
+		const __m256i special = _mm256_or_si256(
+			_mm256_or_si256(
+				_mm256_or_si256(_mm256_cmpeq_epi8(chunk, ending), _mm256_cmpeq_epi8(chunk, reverseSolidus)),
+				_mm256_or_si256(_mm256_cmpeq_epi8(chunk, lineFeed), _mm256_cmpeq_epi8(chunk, carriageReturn))),
+			_mm256_or_si256(_mm256_cmpeq_epi8(chunk, formFeed), _mm256_cmpeq_epi8(chunk, null)));
+		const unsigned mask = static_cast<unsigned>(_mm256_movemask_epi8(_mm256_or_si256(chunk, special)));
+		if (mask != 0)
+		{
+			return position + CountTrailingZeros(mask);
+		}
+	}
+	return position + ScanStringBodySSE2(text + position, size - position, quote);
+}
+
+CSS_PARSER_TARGET_AVX2 SizeType ScanWhitespaceAVX2(const char* text, SizeType size)
+{
+	const __m256i space = _mm256_set1_epi8(' ');
+	const __m256i tabulation = _mm256_set1_epi8('\t');
+	const __m256i lineFeed = _mm256_set1_epi8('\n');
+	const __m256i carriageReturn = _mm256_set1_epi8('\r');
+	const __m256i formFeed = _mm256_set1_epi8('\f');
+	SizeType position = 0;
+	for (; position + 32 <= size; position += 32)
+	{
+		const __m256i chunk = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(text + position));
+		const __m256i whitespace = _mm256_or_si256(
+			_mm256_or_si256(_mm256_cmpeq_epi8(chunk, space), _mm256_cmpeq_epi8(chunk, tabulation)),
+			_mm256_or_si256(
+				_mm256_or_si256(_mm256_cmpeq_epi8(chunk, lineFeed), _mm256_cmpeq_epi8(chunk, carriageReturn)),
+				_mm256_cmpeq_epi8(chunk, formFeed)));
+		const unsigned mask = ~static_cast<unsigned>(_mm256_movemask_epi8(whitespace));
+		if (mask != 0)
+		{
+			return position + CountTrailingZeros(mask);
+		}
+	}
+	return position + ScanWhitespaceSSE2(text + position, size - position);
+}
+
+CSS_PARSER_TARGET_AVX2 SizeType ScanIdentAVX2(const char* text, SizeType size)
+{
+	const __m256i lowercaseBit = _mm256_set1_epi8(0x20);
+	const __m256i beforeA = _mm256_set1_epi8('a' - 1);
+	const __m256i afterZ = _mm256_set1_epi8('z' + 1);
+	const __m256i beforeZero = _mm256_set1_epi8('0' - 1);
+	const __m256i afterNine = _mm256_set1_epi8('9' + 1);
+	const __m256i lowLine = _mm256_set1_epi8('_');
+	const __m256i hyphenMinus = _mm256_set1_epi8('-');
+	SizeType position = 0;
+	for (; position + 32 <= size; position += 32)
+	{
+		const __m256i chunk = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(text + position));
+		const __m256i lowercase = _mm256_or_si256(chunk, lowercaseBit);
+		const __m256i letter = _mm256_and_si256(_mm256_cmpgt_epi8(lowercase, beforeA), _mm256_cmpgt_epi8(afterZ, lowercase));
+		const __m256i digit = _mm256_and_si256(_mm256_cmpgt_epi8(chunk, beforeZero), _mm256_cmpgt_epi8(afterNine, chunk));
+		const __m256i ident = _mm256_or_si256(
+			_mm256_or_si256(letter, digit),
+			_mm256_or_si256(_mm256_cmpeq_epi8(chunk, lowLine), _mm256_cmpeq_epi8(chunk, hyphenMinus)));
+		const unsigned mask = ~static_cast<unsigned>(_mm256_movemask_epi8(ident));
+		if (mask != 0)
+		{
+			return position + CountTrailingZeros(mask);
+		}
+	}
+	return position + ScanIdentSSE2(text + position, size - position);
+}
+
+CSS_PARSER_TARGET_AVX2 SizeType FindCommentEndAVX2(const char* text, SizeType size)
+{
+	const __m256i asterisk = _mm256_set1_epi8('*');
+	const __m256i solidus = _mm256_set1_epi8('/');
+	SizeType position = 0;
+	for (; position + 33 <= size; position += 32)
+	{
+		const __m256i chunk = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(text + position));
+		const __m256i next = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(text + position + 1));
+		const unsigned mask = static_cast<unsigned>(_mm256_movemask_epi8(
+			_mm256_and_si256(_mm256_cmpeq_epi8(chunk, asterisk), _mm256_cmpeq_epi8(next, solidus))));
+		if (mask != 0)
+		{
+			return position + CountTrailingZeros(mask);
+		}
+	}
+	return position + FindCommentEndSSE2(text + position, size - position);
+}
+
+CSS_PARSER_TARGET_AVX512 SizeType ScanPlainASCIIAVX512(const char* text, SizeType size)
+{
+	const __m512i carriageReturn = _mm512_set1_epi8('\r');
+	const __m512i formFeed = _mm512_set1_epi8('\f');
+	const __m512i null = _mm512_setzero_si512();
+	SizeType position = 0;
+	for (; position + 64 <= size; position += 64)
+	{
+		const __m512i chunk = _mm512_loadu_si512(text + position);
+		const uint64_t mask = _mm512_movepi8_mask(chunk)
+			| _mm512_cmpeq_epi8_mask(chunk, carriageReturn)
+			| _mm512_cmpeq_epi8_mask(chunk, formFeed)
+			| _mm512_cmpeq_epi8_mask(chunk, null);
+		if (mask != 0)
+		{
+			return position + CountTrailingZeros64(mask);
+		}
+	}
+	return position + ScanPlainASCIIAVX2(text + position, size - position);
+}
+
+CSS_PARSER_TARGET_AVX512 SizeType FindPreprocessedByteAVX512(const char* text, SizeType size)
+{
+	const __m512i carriageReturn = _mm512_set1_epi8('\r');
+	const __m512i formFeed = _mm512_set1_epi8('\f');
+	const __m512i null = _mm512_setzero_si512();
+	SizeType position = 0;
+	for (; position + 64 <= size; position += 64)
+	{
+		const __m512i chunk = _mm512_loadu_si512(text + position);
+		const uint64_t mask = _mm512_cmpeq_epi8_mask(chunk, carriageReturn)
+			| _mm512_cmpeq_epi8_mask(chunk, formFeed)
+			| _mm512_cmpeq_epi8_mask(chunk, null);
+		if (mask != 0)
+		{
+			return position + CountTrailingZeros64(mask);
+		}
+	}
+	return position + FindPreprocessedByteAVX2(text + position, size - position);
+}
+
+CSS_PARSER_TARGET_AVX512 SizeType ScanStringBodyAVX512(const char* text, SizeType size, char quote)
+{
+	const __m512i ending = _mm512_set1_epi8(quote);
+	const __m512i reverseSolidus = _mm512_set1_epi8('\\');
+	const __m512i lineFeed = _mm512_set1_epi8('\n');
+	const __m512i carriageReturn = _mm512_set1_epi8('\r');
+	const __m512i formFeed = _mm512_set1_epi8('\f');
+	const __m512i null = _mm512_setzero_si512();
+	SizeType position = 0;
+	for (; position + 64 <= size; position += 64)
+	{
+		const __m512i chunk = _mm512_loadu_si512(text + position);
+		const uint64_t mask = _mm512_movepi8_mask(chunk)
+			| _mm512_cmpeq_epi8_mask(chunk, ending)
+			| _mm512_cmpeq_epi8_mask(chunk, reverseSolidus)
+			| _mm512_cmpeq_epi8_mask(chunk, lineFeed)
+			| _mm512_cmpeq_epi8_mask(chunk, carriageReturn)
+			| _mm512_cmpeq_epi8_mask(chunk, formFeed)
+			| _mm512_cmpeq_epi8_mask(chunk, null);
+		if (mask != 0)
+		{
+			return position + CountTrailingZeros64(mask);
+		}
+	}
+	return position + ScanStringBodyAVX2(text + position, size - position, quote);
+}
+
+CSS_PARSER_TARGET_AVX512 SizeType ScanWhitespaceAVX512(const char* text, SizeType size)
+{
+	const __m512i space = _mm512_set1_epi8(' ');
+	const __m512i tabulation = _mm512_set1_epi8('\t');
+	const __m512i lineFeed = _mm512_set1_epi8('\n');
+	const __m512i carriageReturn = _mm512_set1_epi8('\r');
+	const __m512i formFeed = _mm512_set1_epi8('\f');
+	SizeType position = 0;
+	for (; position + 64 <= size; position += 64)
+	{
+		const __m512i chunk = _mm512_loadu_si512(text + position);
+		const uint64_t whitespace = _mm512_cmpeq_epi8_mask(chunk, space)
+			| _mm512_cmpeq_epi8_mask(chunk, tabulation)
+			| _mm512_cmpeq_epi8_mask(chunk, lineFeed)
+			| _mm512_cmpeq_epi8_mask(chunk, carriageReturn)
+			| _mm512_cmpeq_epi8_mask(chunk, formFeed);
+		if (~whitespace != 0)
+		{
+			return position + CountTrailingZeros64(~whitespace);
+		}
+	}
+	return position + ScanWhitespaceAVX2(text + position, size - position);
+}
+
+CSS_PARSER_TARGET_AVX512 SizeType ScanIdentAVX512(const char* text, SizeType size)
+{
+	const __m512i lowercaseBit = _mm512_set1_epi8(0x20);
+	const __m512i beforeA = _mm512_set1_epi8('a' - 1);
+	const __m512i afterZ = _mm512_set1_epi8('z' + 1);
+	const __m512i beforeZero = _mm512_set1_epi8('0' - 1);
+	const __m512i afterNine = _mm512_set1_epi8('9' + 1);
+	const __m512i lowLine = _mm512_set1_epi8('_');
+	const __m512i hyphenMinus = _mm512_set1_epi8('-');
+	SizeType position = 0;
+	for (; position + 64 <= size; position += 64)
+	{
+		const __m512i chunk = _mm512_loadu_si512(text + position);
+		const __m512i lowercase = _mm512_or_si512(chunk, lowercaseBit);
+		const uint64_t ident = (_mm512_cmpgt_epi8_mask(lowercase, beforeA) & _mm512_cmplt_epi8_mask(lowercase, afterZ))
+			| (_mm512_cmpgt_epi8_mask(chunk, beforeZero) & _mm512_cmplt_epi8_mask(chunk, afterNine))
+			| _mm512_cmpeq_epi8_mask(chunk, lowLine)
+			| _mm512_cmpeq_epi8_mask(chunk, hyphenMinus);
+		if (~ident != 0)
+		{
+			return position + CountTrailingZeros64(~ident);
+		}
+	}
+	return position + ScanIdentAVX2(text + position, size - position);
+}
+
+CSS_PARSER_TARGET_AVX512 SizeType FindCommentEndAVX512(const char* text, SizeType size)
+{
+	const __m512i asterisk = _mm512_set1_epi8('*');
+	const __m512i solidus = _mm512_set1_epi8('/');
+	SizeType position = 0;
+	for (; position + 65 <= size; position += 64)
+	{
+		const __m512i chunk = _mm512_loadu_si512(text + position);
+		const __m512i next = _mm512_loadu_si512(text + position + 1);
+		const uint64_t mask = _mm512_cmpeq_epi8_mask(chunk, asterisk) & _mm512_cmpeq_epi8_mask(next, solidus);
+		if (mask != 0)
+		{
+			return position + CountTrailingZeros64(mask);
+		}
+	}
+	return position + FindCommentEndAVX2(text + position, size - position);
+}
+#endif
+
+struct KernelTable
+{
+	SizeType (*m_ScanPlainASCII)(const char*, SizeType);
+	SizeType (*m_FindPreprocessedByte)(const char*, SizeType);
+	SizeType (*m_CountUTF8LeadBytes)(const char*, SizeType);
+	void (*m_WidenASCII)(const char*, SizeType, unsigned*);
+	SizeType (*m_ScanPlainUTF16)(const char*, SizeType, bool);
+	void (*m_WidenUTF16)(const char*, SizeType, bool, unsigned*);
+	SizeType (*m_ScanStringBody)(const char*, SizeType, char);
+	SizeType (*m_ScanWhitespace)(const char*, SizeType);
+	SizeType (*m_ScanCodePointWhitespace)(const unsigned*, SizeType);
+	SizeType (*m_ScanUCS2Whitespace)(const char16_t*, SizeType);
+	SizeType (*m_ScanIdent)(const char*, SizeType);
+	SizeType (*m_FindCommentEnd)(const char*, SizeType);
+	SizeType (*m_FindCodePointCommentEnd)(const unsigned*, SizeType);
+	SizeType (*m_FindUCS2CommentEnd)(const char16_t*, SizeType);
+};
+
+// Indexed by InstructionSet. The kernels that would not gain from wider vectors, mostly those on 16 and 32-bit
+// values, use the ones of the narrower instruction set.
+const KernelTable KERNEL_TABLES[] =
+{
+	{
+		ScanPlainASCIIScalar, FindPreprocessedByteScalar, CountUTF8LeadBytesScalar, WidenASCIIScalar,
+		ScanPlainUTF16Scalar, WidenUTF16Scalar, ScanStringBodyScalar, ScanWhitespaceScalar,
+		ScanCodePointWhitespaceScalar, ScanUCS2WhitespaceScalar, ScanIdentScalar,
+		FindCommentEndScalar, FindCodePointCommentEndScalar, FindUCS2CommentEndScalar
+	},
+#if CSS_PARSER_X86
+	{
+		ScanPlainASCIISSE2, FindPreprocessedByteSSE2, CountUTF8LeadBytesSSE2, WidenASCIISSE2,
+		ScanPlainUTF16SSE2, WidenUTF16SSE2, ScanStringBodySSE2, ScanWhitespaceSSE2,
+		ScanCodePointWhitespaceSSE2, ScanUCS2WhitespaceSSE2, ScanIdentSSE2,
+		FindCommentEndSSE2, FindCodePointCommentEndSSE2, FindUCS2CommentEndSSE2
+	},
+	{
+		ScanPlainASCIIAVX2, FindPreprocessedByteAVX2, CountUTF8LeadBytesAVX2, WidenASCIISSE2,
+		ScanPlainUTF16SSE2, WidenUTF16SSE2, ScanStringBodyAVX2, ScanWhitespaceAVX2,
+		ScanCodePointWhitespaceSSE2, ScanUCS2WhitespaceSSE2, ScanIdentAVX2,
+		FindCommentEndAVX2, FindCodePointCommentEndSSE2, FindUCS2CommentEndSSE2
+	},
+	{
+		ScanPlainASCIIAVX512, FindPreprocessedByteAVX512, CountUTF8LeadBytesAVX2, WidenASCIISSE2,
+		ScanPlainUTF16SSE2, WidenUTF16SSE2, ScanStringBodyAVX512, ScanWhitespaceAVX512,
+		ScanCodePointWhitespaceSSE2, ScanUCS2WhitespaceSSE2, ScanIdentAVX512,
+		FindCommentEndAVX512, FindCodePointCommentEndSSE2, FindUCS2CommentEndSSE2
+	},
+#endif
+};
+
+#if CSS_PARSER_X86
+void ReadCPUID(unsigned leaf, unsigned subleaf, unsigned (&registers)[4])
+{
+#if defined(_MSC_VER)
+	int values[4] = {};
+	__cpuidex(values, static_cast<int>(leaf), static_cast<int>(subleaf));
+	for (unsigned i = 0; i < 4; ++i)
+	{
+		registers[i] = static_cast<unsigned>(values[i]);
+	}
+#else
+	__cpuid_count(leaf, subleaf, registers[0], registers[1], registers[2], registers[3]);
+#endif
+}
+
+// The register states the OS saves on context switches.
+uint64_t ReadXCR0()
+{
+#if defined(_MSC_VER)
+	return _xgetbv(0);
+#else
+	unsigned low = 0;
+	unsigned high = 0;
+	__asm__ volatile("xgetbv" : "=a"(low), "=d"(high) : "c"(0));
+	return (static_cast<uint64_t>(high) << 32) | low;
+#endif
+}
+#endif
+
+InstructionSet DetectInstructionSet()
+{
+#if CSS_PARSER_X86
+	constexpr unsigned EAX = 0, EBX = 1, ECX = 2, EDX = 3;
+	unsigned registers[4] = {};
+	ReadCPUID(0, 0, registers);
+	const unsigned maxLeaf = registers[EAX];
+	ReadCPUID(1, 0, registers);
+	if (!(registers[EDX] & (1u << 26)))
+	{
+		return InstructionSet::Scalar;
+	}
+	// The AVX registers are usable only when the CPU has AVX and the OS saves them, which OSXSAVE and XCR0 tell.
+	const bool hasAVX = (registers[ECX] & (1u << 27)) && (registers[ECX] & (1u << 28));
+	if (!hasAVX || maxLeaf < 7 || (ReadXCR0() & 0x06) != 0x06)
+	{
+		return InstructionSet::SSE2;
+	}
+	ReadCPUID(7, 0, registers);
+	if (!(registers[EBX] & (1u << 5)))
+	{
+		return InstructionSet::SSE2;
+	}
+	// AVX-512F and AVX-512BW, with the opmask and upper ZMM registers saved by the OS.
+	const bool hasAVX512 = (registers[EBX] & (1u << 16)) && (registers[EBX] & (1u << 30)) && (ReadXCR0() & 0xE0) == 0xE0;
+	return hasAVX512 ? InstructionSet::AVX512 : InstructionSet::AVX2;
+#else
+	return InstructionSet::Scalar;
+#endif
+}
+
+// -1 until the instruction set is detected, on the first use of a kernel.
+std::atomic<int> s_InstructionSet(-1);
+
+const KernelTable& GetKernels()
+{
+	int instructionSet = s_InstructionSet.load(std::memory_order_relaxed);
+	if (instructionSet < 0)
+	{
+		instructionSet = static_cast<int>(DetectInstructionSet());
+		s_InstructionSet.store(instructionSet, std::memory_order_relaxed);
+	}
+	return KERNEL_TABLES[instructionSet];
+}
+}
+
+InstructionSet GetInstructionSet()
+{
+	GetKernels();
+	return static_cast<InstructionSet>(s_InstructionSet.load(std::memory_order_relaxed));
+}
+
+bool SetInstructionSet(InstructionSet instructionSet)
+{
+	// Each instruction set includes the narrower ones.
+	if (instructionSet > DetectInstructionSet())
+	{
+		return false;
+	}
+	s_InstructionSet.store(static_cast<int>(instructionSet), std::memory_order_relaxed);
+	return true;
+}
+
+SizeType ScanPlainASCII(const char* text, SizeType size)
+{
+	return GetKernels().m_ScanPlainASCII(text, size);
+}
+
+SizeType FindPreprocessedByte(const char* text, SizeType size)
+{
+	return GetKernels().m_FindPreprocessedByte(text, size);
+}
+
+SizeType CountUTF8LeadBytes(const char* text, SizeType size)
+{
+	return GetKernels().m_CountUTF8LeadBytes(text, size);
+}
+
+void WidenASCII(const char* text, SizeType size, unsigned* output)
+{
+	GetKernels().m_WidenASCII(text, size, output);
+}
+
+SizeType ScanPlainUTF16(const char* text, SizeType count, bool isBigEndian)
+{
+	return GetKernels().m_ScanPlainUTF16(text, count, isBigEndian);
+}
+
+void WidenUTF16(const char* text, SizeType count, bool isBigEndian, unsigned* output)
+{
+	GetKernels().m_WidenUTF16(text, count, isBigEndian, output);
+}
+
+SizeType ScanStringBody(const char* text, SizeType size, char quote)
+{
+	return GetKernels().m_ScanStringBody(text, size, quote);
+}
+
+SizeType ScanWhitespace(const char* text, SizeType size)
+{
+	return GetKernels().m_ScanWhitespace(text, size);
+}
+
+SizeType ScanWhitespace(const unsigned* codePoints, SizeType count)
+{
+	return GetKernels().m_ScanCodePointWhitespace(codePoints, count);
+}
+
+SizeType ScanWhitespace(const char16_t* codePoints, SizeType count)
+{
+	return GetKernels().m_ScanUCS2Whitespace(codePoints, count);
+}
+
+SizeType ScanIdent(const char* text, SizeType size)
+{
+	return GetKernels().m_ScanIdent(text, size);
+}
+
+SizeType FindCommentEnd(const char* text, SizeType size)
+{
+	return GetKernels().m_FindCommentEnd(text, size);
+}
+
+SizeType FindCommentEnd(const unsigned* codePoints, SizeType count)
+{
+	return GetKernels().m_FindCodePointCommentEnd(codePoints, count);
+}
+
+SizeType FindCommentEnd(const char16_t* codePoints, SizeType count)
+{
+	return GetKernels().m_FindUCS2CommentEnd(codePoints, count);
+}
+}
@@ -0,0 +1,70 @@
+/*
+MIT License
+
+Copyright (c) 2024 omalinov
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#pragma once
+
+#include "CommonTypes.h"
+
+namespace css_parser
+{
+// Returns the length of the longest run at the start of text made only of bytes that UTF-8 decoding
+// and the input preprocessing leave unchanged, i.e. ASCII bytes other than U+000D CARRIAGE RETURN (CR),
+// U+000C FORM FEED (FF) and U+0000 NULL.
+SizeType ScanPlainASCII(const char* text, SizeType size);
+// Returns the position of the first byte of UTF-8 text that the input preprocessing changes, i.e. U+000D CARRIAGE
+// RETURN (CR), U+000C FORM FEED (FF) or U+0000 NULL, or size if there is none. All three are ASCII, so they can be
+// searched in UTF-8 bytes without decoding them.
+SizeType FindPreprocessedByte(const char* text, SizeType size);
+// Returns the number of bytes of text that are not UTF-8 continuation bytes (0x80 to 0xBF). Every code point
+// of valid UTF-8 starts with exactly one of them, so this is the number of code points it decodes to.
+SizeType CountUTF8LeadBytes(const char* text, SizeType size);
+// Widens size ASCII bytes into size 32-bit code point values.
+void WidenASCII(const char* text, SizeType size, unsigned* output);
+// The UTF-16 counterpart of ScanPlainASCII. Returns the number of leading code units out of count that are
+// neither surrogates nor U+000D CARRIAGE RETURN (CR), U+000C FORM FEED (FF) or U+0000 NULL.
+SizeType ScanPlainUTF16(const char* text, SizeType count, bool isBigEndian);
+// Widens count UTF-16 code units into count 32-bit code point values.
+void WidenUTF16(const char* text, SizeType count, bool isBigEndian, unsigned* output);
+// Returns the length of the longest run at the start of text of ASCII bytes that a string token with the ending code
+// point quote takes as they are: anything but quote, U+005C REVERSE SOLIDUS (\), newlines and the bytes the input
+// preprocessing changes.
+SizeType ScanStringBody(const char* text, SizeType size, char quote);
+// Returns the length of the longest run of whitespace at the start of text. U+000D CARRIAGE RETURN (CR) and
+// U+000C FORM FEED (FF) are included, the input preprocessing turns them into whitespace too.
+SizeType ScanWhitespace(const char* text, SizeType size);
+// The code point counterpart of ScanWhitespace, for count 32-bit code point values.
+SizeType ScanWhitespace(const unsigned* codePoints, SizeType count);
+// The code point counterpart of ScanWhitespace, for count code points stored as 16-bit code units.
+SizeType ScanWhitespace(const char16_t* codePoints, SizeType count);
+// Returns the length of the longest run of ASCII ident code points at the start of text.
+// Non-ASCII ident code points end the run, as their bytes may not be valid UTF-8.
+SizeType ScanIdent(const char* text, SizeType size);
+// Returns the position of the first U+002A ASTERISK (*) followed by a U+002F SOLIDUS (/), or size if there is none.
+// Both are ASCII, so they can be searched in UTF-8 bytes without decoding them.
+SizeType FindCommentEnd(const char* text, SizeType size);
+// The code point counterpart of FindCommentEnd, for count 32-bit code point values.
+SizeType FindCommentEnd(const unsigned* codePoints, SizeType count);
+// The code point counterpart of FindCommentEnd, for count code points stored as 16-bit code units.
+SizeType FindCommentEnd(const char16_t* codePoints, SizeType count);
+}
@@ -0,0 +1,241 @@
+/*
+MIT License
+
+Copyright (c) 2024 omalinov
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#include "MappedFile.h"
+
+#include <cstdint>
+#include <limits>
+
+#if defined(_WIN32)
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <cerrno>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace css_parser
+{
+MappedFile::MappedFile()
+	: m_Data(nullptr)
+	, m_Size(0)
+	, m_IsMapped(false)
+{
+}
+
+MappedFile::~MappedFile()
+{
+	Close();
+}
+
+#if defined(_WIN32)
+namespace
+{
+bool ReadAll(HANDLE file, String& output)
+{
+	char buffer[64 * 1024];
+	for (;;)
+	{
+		DWORD size = 0;
+		if (!ReadFile(file, buffer, static_cast<DWORD>(sizeof(buffer)), &size, nullptr))
+		{
+			// The writing end of a pipe was closed.
+			return GetLastError() == ERROR_BROKEN_PIPE;
+		}
+		if (size == 0)
+		{
+			return true;
+		}
+		output.append(buffer, size);
+	}
+}
+}
+
+bool MappedFile::Open(const char* path)
+{
+	Close();
+	const int wideSize = MultiByteToWideChar(CP_UTF8, MB_ERR_INVALID_CHARS, path, -1, nullptr, 0);
+	if (wideSize == 0)
+	{
+		return false;
+	}
+	std::wstring widePath(static_cast<SizeType>(wideSize), L'\0');
+	MultiByteToWideChar(CP_UTF8, MB_ERR_INVALID_CHARS, path, -1, &widePath[0], wideSize);
+	const HANDLE file = CreateFileW(widePath.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING,
+		FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+	if (file == INVALID_HANDLE_VALUE)
+	{
+		return false;
+	}
+	if (GetFileType(file) != FILE_TYPE_DISK)
+	{
+		const bool isRead = ReadAll(file, m_Contents);
+		CloseHandle(file);
+		if (!isRead)
+		{
+			m_Contents.clear();
+			return false;
+		}
+		m_Data = m_Contents.data();
+		m_Size = m_Contents.size();
+		return true;
+	}
+	LARGE_INTEGER fileSize;
+	if (!GetFileSizeEx(file, &fileSize) || static_cast<uint64_t>(fileSize.QuadPart) > std::numeric_limits<SizeType>::max())
+	{
+		CloseHandle(file);
+		return false;
+	}
+	if (fileSize.QuadPart == 0)
+	{
+		CloseHandle(file);
+		m_Data = "";
+		return true;
+	}
+	// The view keeps the mapping and the file open once their handles are closed.
+	const HANDLE mapping = CreateFileMappingW(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+	CloseHandle(file);
+	if (!mapping)
+	{
+		return false;
+	}
+	const void* view = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+	CloseHandle(mapping);
+	if (!view)
+	{
+		return false;
+	}
+	m_Data = static_cast<const char*>(view);
+	m_Size = static_cast<SizeType>(fileSize.QuadPart);
+	m_IsMapped = true;
+	return true;
+}
+
+void MappedFile::Close()
+{
+	if (m_IsMapped)
+	{
+		UnmapViewOfFile(m_Data);
+	}
+	m_Data = nullptr;
+	m_Size = 0;
+	m_IsMapped = false;
+	m_Contents.clear();
+}
+#else
+namespace
+{
+bool ReadAll(int file, String& output)
+{
+	char buffer[64 * 1024];
+	for (;;)
+	{
+		const ssize_t size = read(file, buffer, sizeof(buffer));
+		if (size < 0 && errno != EINTR)
+		{
+			return false;
+		}
+		if (size == 0)
+		{
+			return true;
+		}
+		if (size > 0)
+		{
+			output.append(buffer, static_cast<SizeType>(size));
+		}
+	}
+}
+}
+
+bool MappedFile::Open(const char* path)
+{
+	Close();
+	const int file = open(path, O_RDONLY | O_CLOEXEC);
+	if (file < 0)
+	{
+		return false;
+	}
+	struct stat status;
+	if (fstat(file, &status) != 0 || static_cast<uint64_t>(status.st_size) > std::numeric_limits<SizeType>::max())
+	{
+		close(file);
+		return false;
+	}
+	if (!S_ISREG(status.st_mode) || status.st_size == 0)
+	{
+		// Files in /proc and the like report a size of 0 whatever they hold, so empty files are read too.
+		const bool isRead = ReadAll(file, m_Contents);
+		close(file);
+		if (!isRead)
+		{
+			m_Contents.clear();
+			return false;
+		}
+		m_Data = m_Contents.data();
+		m_Size = m_Contents.size();
+		return true;
+	}
+	const SizeType size = static_cast<SizeType>(status.st_size);
+	// The mapping keeps the file open once its descriptor is closed.
+	void* mapping = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, file, 0);
+	close(file);
+	if (mapping == MAP_FAILED)
+	{
+		return false;
+	}
+	// The tokenizer reads the file once from start to end, so the kernel can read ahead and drop the pages behind.
+	madvise(mapping, size, MADV_SEQUENTIAL);
+	m_Data = static_cast<const char*>(mapping);
+	m_Size = size;
+	m_IsMapped = true;
+	return true;
+}
+
+void MappedFile::Close()
+{
+	if (m_IsMapped)
+	{
+		munmap(const_cast<char*>(m_Data), m_Size);
+	}
+	m_Data = nullptr;
+	m_Size = 0;
+	m_IsMapped = false;
+	m_Contents.clear();
+}
+#endif
+
+const char* MappedFile::GetData() const
+{
+	return m_Data;
+}
+
+SizeType MappedFile::GetSize() const
+{
+	return m_Size;
+}
+}
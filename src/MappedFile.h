@@ -0,0 +1,57 @@
+/*
+MIT License
+
+Copyright (c) 2024 omalinov
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#pragma once
+
+#include "CommonTypes.h"
+
+namespace css_parser
+{
+// A file mapped read-only into memory, so it can be tokenized without being read into a buffer first and
+// without a second copy of its pages besides the ones in the page cache.
+// Files that cannot be mapped, like pipes, or whose size is not known up front, like the ones in /proc, are read
+// into a buffer instead.
+class MappedFile
+{
+public:
+	MappedFile();
+	~MappedFile();
+	MappedFile(const MappedFile&) = delete;
+	MappedFile& operator=(const MappedFile&) = delete;
+
+	// path is UTF-8 encoded. Returns false if the file cannot be opened, mapped or read, e.g. for a directory,
+	// or does not fit in the address space.
+	bool Open(const char* path);
+	// Empty files are not mapped, their data is an empty string, so it is never a null pointer once a file is open.
+	const char* GetData() const;
+	SizeType GetSize() const;
+private:
+	void Close();
+
+	const char* m_Data;
+	SizeType m_Size;
+	bool m_IsMapped;
+	String m_Contents;
+};
+}
@@ -0,0 +1,128 @@
+/*
+MIT License
+
+Copyright (c) 2024 omalinov
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#include "Numbers.h"
+#include "CSSParserAssert.h"
+
+#include <charconv>
+#include <limits>
+
+namespace css_parser
+{
+namespace
+{
+// The powers of ten that are exact doubles.
+constexpr double EXACT_POWERS_OF_TEN[] =
+{
+	1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+	1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+};
+constexpr int MAX_EXACT_POWER_OF_TEN = 22;
+// The largest integer below which all integers are exact doubles.
+constexpr uint64_t MAX_EXACT_INTEGER = uint64_t(1) << 53;
+}
+
+int64_t ConvertDecimalToInteger(const DecimalNumber& number)
+{
+	CSS_PARSER_ASSERT(number.m_Exponent >= 0, "Integers have no fractional part");
+	const uint64_t limit = number.m_IsNegative
+		? uint64_t(std::numeric_limits<int64_t>::max()) + 1
+		: uint64_t(std::numeric_limits<int64_t>::max());
+	if (number.m_Exponent > 0 || number.m_Significand > limit)
+	{
+		// The digits did not fit in m_Significand, or do not fit in an int64_t.
+		return number.m_IsNegative ? std::numeric_limits<int64_t>::min() : std::numeric_limits<int64_t>::max();
+	}
+	return number.m_IsNegative ? int64_t(0 - number.m_Significand) : int64_t(number.m_Significand);
+}
+
+bool ConvertDecimalToDoubleFast(const DecimalNumber& number, double& output)
+{
+	if (number.m_IsTruncated)
+	{
+		return false;
+	}
+	if (number.m_Significand == 0)
+	{
+		output = number.m_IsNegative ? -0.0 : 0.0;
+		return true;
+	}
+	if (number.m_Significand > MAX_EXACT_INTEGER || number.m_Exponent < -MAX_EXACT_POWER_OF_TEN)
+	{
+		return false;
+	}
+	uint64_t significand = number.m_Significand;
+	int exponent = number.m_Exponent;
+	if (exponent > MAX_EXACT_POWER_OF_TEN)
+	{
+		// E.g. 12e30: the excess power of ten can go to the significand while it stays exact, 12e8 * 1e22.
+		const int excess = exponent - MAX_EXACT_POWER_OF_TEN;
+		if (excess > 15)
+		{
+			return false;
+		}
+		const uint64_t power = static_cast<uint64_t>(EXACT_POWERS_OF_TEN[excess]);
+		if (significand > MAX_EXACT_INTEGER / power)
+		{
+			return false;
+		}
+		significand *= power;
+		exponent = MAX_EXACT_POWER_OF_TEN;
+	}
+	double value = static_cast<double>(significand);
+	if (exponent < 0)
+	{
+		value /= EXACT_POWERS_OF_TEN[-exponent];
+	}
+	else
+	{
+		value *= EXACT_POWERS_OF_TEN[exponent];
+	}
+	output = number.m_IsNegative ? -value : value;
+	return true;
+}
+
+double ConvertStringToDouble(const DecimalNumber& number, const StringView& repr)
+{
+	const char* begin = repr.data();
+	const char* end = repr.data() + repr.size();
+	if (begin != end && *begin == '+')
+	{
+		// std::from_chars accepts only a minus sign.
+		++begin;
+	}
+	double value = 0.0;
+	const std::from_chars_result result = std::from_chars(begin, end, value);
+	if (result.ec == std::errc::result_out_of_range)
+	{
+		// The value is then left unchanged, whether it is too large or too small is told by
+		// the position of the decimal point relative to the first significant digit.
+		const bool isTooLarge = static_cast<int64_t>(number.m_DigitCount) + number.m_Exponent > 0;
+		value = isTooLarge ? std::numeric_limits<double>::infinity() : 0.0;
+		return number.m_IsNegative ? -value : value;
+	}
+	CSS_PARSER_ASSERT(result.ec == std::errc() && result.ptr == end, "Expects the text of a consumed number");
+	return value;
+}
+}
@@ -0,0 +1,75 @@
+/*
+MIT License
+
+Copyright (c) 2024 omalinov
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#pragma once
+
+#include "CommonTypes.h"
+
+namespace css_parser
+{
+// The digits of a number, as they are consumed by https://www.w3.org/TR/css-syntax-3/#consume-number.
+// The value is m_Significand * 10^m_Exponent, with the sign applied, unless m_IsTruncated is set.
+struct DecimalNumber
+{
+	// Number of significant digits that always fit in m_Significand.
+	constexpr static unsigned MAX_DIGITS = 19;
+	// Explicit exponents are not accumulated past this, the value is an infinity or zero long before.
+	constexpr static int MAX_EXPONENT = 100000;
+
+	uint64_t m_Significand = 0;
+	int m_Exponent = 0;
+	// Significant digits in m_Significand.
+	unsigned m_DigitCount = 0;
+	bool m_IsNegative = false;
+	// Whether non-zero digits were dropped from m_Significand.
+	bool m_IsTruncated = false;
+};
+
+// Appends a digit of the integer part or of the fractional part.
+inline void AppendDigit(DecimalNumber& number, unsigned digit, bool isFraction)
+{
+	if (number.m_DigitCount < DecimalNumber::MAX_DIGITS)
+	{
+		if (number.m_Significand != 0 || digit != 0)
+		{
+			number.m_Significand = number.m_Significand * 10 + digit;
+			++number.m_DigitCount;
+		}
+		number.m_Exponent -= isFraction;
+		return;
+	}
+	number.m_IsTruncated |= digit != 0;
+	number.m_Exponent += !isFraction;
+}
+
+// The integer value of a number with the "integer" type flag. Values out of the int64_t range are clamped.
+int64_t ConvertDecimalToInteger(const DecimalNumber& number);
+// Clinger's fast path: when the significand and the power of ten are both exact doubles, a single correctly
+// rounded multiplication or division gives the correctly rounded value.
+// Returns false when the fast path does not apply, the value then needs ConvertStringToDouble.
+bool ConvertDecimalToDoubleFast(const DecimalNumber& number, double& output);
+// Correctly rounded conversion of the text of a number, repr as it was consumed, with the slow but exact
+// algorithm of the standard library. Values out of the double range become an infinity or zero.
+double ConvertStringToDouble(const DecimalNumber& number, const StringView& repr);
+}
@@ -0,0 +1,533 @@
+/*
+MIT License
+
+Copyright (c) 2024 omalinov
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#include "StyleSheet.h"
+#include "CSSParserAssert.h"
+
+namespace css_parser
+{
+namespace
+{
+// https://www.w3.org/TR/css-syntax-3/#ascii-case-insensitive, lowercase has to be in lowercase.
+bool EqualsIgnoringASCIICase(const StringView& value, const StringView& lowercase)
+{
+	if (value.size() != lowercase.size())
+	{
+		return false;
+	}
+	for (SizeType i = 0; i < value.size(); ++i)
+	{
+		const char c = value[i];
+		if ((c >= 'A' && c <= 'Z' ? char(c - 'A' + 'a') : c) != lowercase[i])
+		{
+			return false;
+		}
+	}
+	return true;
+}
+
+// https://www.w3.org/TR/css-variables-1/#custom-property
+bool IsCustomPropertyName(const StringView& name)
+{
+	return name.size() >= 2 && name[0] == '-' && name[1] == '-';
+}
+}
+
+StyleSheet::StyleSheet(const TokenList& tokens, MemoryResource* resource)
+	: m_Tokens(tokens)
+	, m_Rules(resource)
+	, m_Declarations(resource)
+	, m_ComponentValues(resource)
+{
+	ConsumeStyleSheetContents(0, static_cast<unsigned>(tokens.m_Tokens.size()));
+}
+
+const TokenList& StyleSheet::GetTokens() const
+{
+	return m_Tokens;
+}
+
+IndexRange StyleSheet::GetRules() const
+{
+	return m_StyleSheetRules;
+}
+
+const Rule& StyleSheet::GetRule(unsigned index) const
+{
+	CSS_PARSER_ASSERT(index < m_Rules.size(), "Expects the index of a rule");
+	return m_Rules[index];
+}
+
+IndexRange StyleSheet::GetDeclarations(unsigned ruleIndex)
+{
+	CSS_PARSER_ASSERT(ruleIndex < m_Rules.size(), "Expects the index of a rule");
+	ParseBlock(ruleIndex);
+	return m_Rules[ruleIndex].m_Declarations;
+}
+
+IndexRange StyleSheet::GetChildRules(unsigned ruleIndex)
+{
+	CSS_PARSER_ASSERT(ruleIndex < m_Rules.size(), "Expects the index of a rule");
+	ParseBlock(ruleIndex);
+	return m_Rules[ruleIndex].m_ChildRules;
+}
+
+const Declaration& StyleSheet::GetDeclaration(unsigned index) const
+{
+	CSS_PARSER_ASSERT(index < m_Declarations.size(), "Expects the index of a declaration");
+	return m_Declarations[index];
+}
+
+IndexRange StyleSheet::GetPreludeValues(unsigned ruleIndex)
+{
+	CSS_PARSER_ASSERT(ruleIndex < m_Rules.size(), "Expects the index of a rule");
+	if (!m_Rules[ruleIndex].m_IsPreludeParsed)
+	{
+		const IndexRange values = ParseComponentValues(m_Rules[ruleIndex].m_Prelude);
+		m_Rules[ruleIndex].m_PreludeValues = values;
+		m_Rules[ruleIndex].m_IsPreludeParsed = true;
+	}
+	return m_Rules[ruleIndex].m_PreludeValues;
+}
+
+IndexRange StyleSheet::GetDeclarationValues(unsigned declarationIndex)
+{
+	CSS_PARSER_ASSERT(declarationIndex < m_Declarations.size(), "Expects the index of a declaration");
+	if (!m_Declarations[declarationIndex].m_IsValueParsed)
+	{
+		const IndexRange values = ParseComponentValues(m_Declarations[declarationIndex].m_Value);
+		m_Declarations[declarationIndex].m_Values = values;
+		m_Declarations[declarationIndex].m_IsValueParsed = true;
+	}
+	return m_Declarations[declarationIndex].m_Values;
+}
+
+const ComponentValue& StyleSheet::GetComponentValue(unsigned index) const
+{
+	CSS_PARSER_ASSERT(index < m_ComponentValues.size(), "Expects the index of a component value");
+	return m_ComponentValues[index];
+}
+
+// https://www.w3.org/TR/css-syntax-3/#consume-list-of-components
+// The list is consumed one level at a time: its values first, then the children of its functions and simple blocks
+// after them, then theirs, so that the children of each value are consecutive.
+IndexRange StyleSheet::ParseComponentValues(const IndexRange& tokens)
+{
+	const IndexRange values = AppendComponentValues(tokens.m_Begin, tokens.m_End);
+	for (unsigned index = values.m_Begin; index < m_ComponentValues.size(); ++index)
+	{
+		if (m_ComponentValues[index].m_Type != ComponentValueType::PreservedToken)
+		{
+			const IndexRange childTokens = m_ComponentValues[index].m_Children;
+			const IndexRange children = AppendComponentValues(childTokens.m_Begin, childTokens.m_End);
+			m_ComponentValues[index].m_Children = children;
+		}
+	}
+	return values;
+}
+
+void StyleSheet::ParseAll()
+{
+	// The rules of the blocks are added to m_Rules, and parsed in turn.
+	for (unsigned rule = 0; rule < m_Rules.size(); ++rule)
+	{
+		ParseBlock(rule);
+		GetPreludeValues(rule);
+	}
+	for (unsigned declaration = 0; declaration < m_Declarations.size(); ++declaration)
+	{
+		GetDeclarationValues(declaration);
+	}
+}
+
+const Token& StyleSheet::GetToken(unsigned index) const
+{
+	return m_Tokens.m_Tokens[index];
+}
+
+unsigned StyleSheet::SkipComponentValue(unsigned position, unsigned end) const
+{
+	const Token& token = GetToken(position);
+	if (GetClosingType(token.GetType()) == TokenType::EndOfFile)
+	{
+		return position + 1;
+	}
+	// Blocks that are not closed go on until the end of the input, and so do the ones around them.
+	const unsigned partner = token.GetPartnerIndex();
+	return partner == Token::NO_PARTNER ? end : partner + 1;
+}
+
+// https://www.w3.org/TR/css-syntax-3/#consume-component-value
+// The children of the appended functions and simple blocks are left as the range of their tokens,
+// https://www.w3.org/TR/css-syntax-3/#consume-function and https://www.w3.org/TR/css-syntax-3/#consume-simple-block
+// are done by ParseComponentValues.
+IndexRange StyleSheet::AppendComponentValues(unsigned position, unsigned end)
+{
+	const unsigned valuesBegin = static_cast<unsigned>(m_ComponentValues.size());
+	while (position < end)
+	{
+		const Token& token = GetToken(position);
+		ComponentValue value;
+		value.m_Token = position;
+		if (GetClosingType(token.GetType()) == TokenType::EndOfFile)
+		{
+			++position;
+		}
+		else
+		{
+			value.m_Type = token.GetType() == TokenType::Function ? ComponentValueType::Function : ComponentValueType::SimpleBlock;
+			// The ending token is not a child, and the contents of a block that is not closed go on until the end.
+			const unsigned partner = token.GetPartnerIndex();
+			CSS_PARSER_ASSERT(partner == Token::NO_PARTNER || partner < end, "A block goes past the end of its list");
+			value.m_Children = {position + 1, partner == Token::NO_PARTNER ? end : partner};
+			position = partner == Token::NO_PARTNER ? end : partner + 1;
+		}
+		m_ComponentValues.push_back(value);
+	}
+	return {valuesBegin, static_cast<unsigned>(m_ComponentValues.size())};
+}
+
+void StyleSheet::ParseBlock(unsigned ruleIndex)
+{
+	const Rule& rule = m_Rules[ruleIndex];
+	if (rule.m_IsBlockParsed)
+	{
+		return;
+	}
+	const IndexRange block = rule.m_Block;
+	const unsigned rulesBegin = static_cast<unsigned>(m_Rules.size());
+	// Nested blocks are left for later as well, so the rules and the declarations of this one are contiguous.
+	const IndexRange declarations = ConsumeBlockContents(block.m_Begin, block.m_End);
+	Rule& parsed = m_Rules[ruleIndex];
+	parsed.m_Declarations = declarations;
+	parsed.m_ChildRules = {rulesBegin, static_cast<unsigned>(m_Rules.size())};
+	parsed.m_IsBlockParsed = true;
+}
+
+// https://www.w3.org/TR/css-syntax-3/#consume-stylesheet-contents
+void StyleSheet::ConsumeStyleSheetContents(unsigned position, unsigned end)
+{
+	const unsigned rulesBegin = static_cast<unsigned>(m_Rules.size());
+	while (position < end)
+	{
+		switch (GetToken(position).GetType())
+		{
+		case TokenType::Whitespace:
+		case TokenType::CDO:
+		case TokenType::CDC:
+			++position;
+			break;
+		case TokenType::AtKeyword:
+		{
+			Rule rule;
+			ConsumeAtRule(position, end, false, rule);
+			m_Rules.push_back(rule);
+			break;
+		}
+		default:
+		{
+			Rule rule;
+			if (ConsumeQualifiedRule(position, end, false, false, rule))
+			{
+				m_Rules.push_back(rule);
+			}
+			break;
+		}
+		}
+	}
+	m_StyleSheetRules = {rulesBegin, static_cast<unsigned>(m_Rules.size())};
+}
+
+// https://www.w3.org/TR/css-syntax-3/#consume-at-rule
+void StyleSheet::ConsumeAtRule(unsigned& position, unsigned end, bool isNested, Rule& rule) const
+{
+	CSS_PARSER_ASSERT(GetToken(position).GetType() == TokenType::AtKeyword, "Expects an at-keyword token");
+	rule.m_Type = RuleType::At;
+	rule.m_Name = position++;
+	rule.m_Prelude.m_Begin = position;
+	while (position < end)
+	{
+		switch (GetToken(position).GetType())
+		{
+		case TokenType::SemiColon:
+			rule.m_Prelude.m_End = position++;
+			return;
+		case TokenType::RightCurlyBracket:
+			if (isNested)
+			{
+				rule.m_Prelude.m_End = position;
+				return;
+			}
+			// A parse error, the token is part of the prelude.
+			++position;
+			break;
+		case TokenType::LeftCurlyBracket:
+			rule.m_Prelude.m_End = position;
+			ConsumeBlock(position, end, rule);
+			return;
+		default:
+			position = SkipComponentValue(position, end);
+			break;
+		}
+	}
+	rule.m_Prelude.m_End = position;
+}
+
+// https://www.w3.org/TR/css-syntax-3/#consume-qualified-rule
+// Returns false when it consumes nothing that is a rule.
+bool StyleSheet::ConsumeQualifiedRule(unsigned& position, unsigned end, bool isNested, bool isStoppedBySemiColon,
+	Rule& rule) const
+{
+	rule.m_Type = RuleType::Qualified;
+	rule.m_Prelude.m_Begin = position;
+	while (position < end)
+	{
+		switch (GetToken(position).GetType())
+		{
+		case TokenType::SemiColon:
+			if (isStoppedBySemiColon)
+			{
+				return false;
+			}
+			++position;
+			break;
+		case TokenType::RightCurlyBracket:
+			if (isNested)
+			{
+				return false;
+			}
+			++position;
+			break;
+		case TokenType::LeftCurlyBracket:
+		{
+			rule.m_Prelude.m_End = position;
+			// A prelude that starts like a custom property declaration is one that is not valid in this context.
+			unsigned first = rule.m_Prelude.m_Begin;
+			while (first < position && GetToken(first).GetType() == TokenType::Whitespace)
+			{
+				++first;
+			}
+			unsigned second = first + 1;
+			while (second < position && GetToken(second).GetType() == TokenType::Whitespace)
+			{
+				++second;
+			}
+			if (second < position && GetToken(first).GetType() == TokenType::Ident
+				&& IsCustomPropertyName(m_Tokens.GetValue(GetToken(first))) && GetToken(second).GetType() == TokenType::Colon)
+			{
+				if (isNested)
+				{
+					ConsumeBadDeclarationRemnants(position, end, true);
+				}
+				else
+				{
+					position = SkipComponentValue(position, end);
+				}
+				return false;
+			}
+			ConsumeBlock(position, end, rule);
+			return true;
+		}
+		default:
+			position = SkipComponentValue(position, end);
+			break;
+		}
+	}
+	return false;
+}
+
+// https://www.w3.org/TR/css-syntax-3/#consume-block
+// Only the range of the contents is kept, they are consumed by ParseBlock.
+void StyleSheet::ConsumeBlock(unsigned& position, unsigned end, Rule& rule) const
+{
+	CSS_PARSER_ASSERT(GetToken(position).GetType() == TokenType::LeftCurlyBracket, "Expects a { token");
+	const unsigned partner = GetToken(position).GetPartnerIndex();
+	rule.m_HasBlock = true;
+	rule.m_Block = {position + 1, partner == Token::NO_PARTNER ? end : partner};
+	position = partner == Token::NO_PARTNER ? end : partner + 1;
+}
+
+// https://www.w3.org/TR/css-syntax-3/#consume-block-contents
+IndexRange StyleSheet::ConsumeBlockContents(unsigned position, unsigned end)
+{
+	const unsigned rulesBegin = static_cast<unsigned>(m_Rules.size());
+	unsigned declarationsBegin = static_cast<unsigned>(m_Declarations.size());
+	IndexRange declarations = {declarationsBegin, declarationsBegin};
+	while (position < end)
+	{
+		switch (GetToken(position).GetType())
+		{
+		case TokenType::Whitespace:
+		case TokenType::SemiColon:
+			++position;
+			break;
+		case TokenType::RightCurlyBracket:
+			position = end;
+			break;
+		case TokenType::AtKeyword:
+		{
+			Rule rule;
+			ConsumeAtRule(position, end, true, rule);
+			EndDeclarations(rulesBegin, declarationsBegin, declarations);
+			m_Rules.push_back(rule);
+			break;
+		}
+		default:
+		{
+			const unsigned mark = position;
+			Declaration declaration;
+			if (ConsumeDeclaration(position, end, true, declaration))
+			{
+				m_Declarations.push_back(declaration);
+				break;
+			}
+			position = mark;
+			Rule rule;
+			if (ConsumeQualifiedRule(position, end, true, true, rule))
+			{
+				EndDeclarations(rulesBegin, declarationsBegin, declarations);
+				m_Rules.push_back(rule);
+			}
+			break;
+		}
+		}
+	}
+	EndDeclarations(rulesBegin, declarationsBegin, declarations);
+	return declarations;
+}
+
+// Ends the declarations since declarationsBegin, at a nested rule or at the end of the block. The ones before the first
+// nested rule are the declarations of the block itself, the others are wrapped in a nested declarations rule,
+// which keeps their order relative to the rules.
+void StyleSheet::EndDeclarations(unsigned rulesBegin, unsigned& declarationsBegin, IndexRange& declarations)
+{
+	const unsigned declarationsEnd = static_cast<unsigned>(m_Declarations.size());
+	if (m_Rules.size() == rulesBegin)
+	{
+		declarations.m_End = declarationsEnd;
+	}
+	else if (declarationsEnd > declarationsBegin)
+	{
+		Rule nested;
+		nested.m_Type = RuleType::NestedDeclarations;
+		nested.m_IsBlockParsed = true;
+		nested.m_IsPreludeParsed = true;
+		nested.m_Declarations = {declarationsBegin, declarationsEnd};
+		m_Rules.push_back(nested);
+	}
+	declarationsBegin = declarationsEnd;
+}
+
+// https://www.w3.org/TR/css-syntax-3/#consume-declaration
+// Returns false when it consumes nothing that is a declaration.
+bool StyleSheet::ConsumeDeclaration(unsigned& position, unsigned end, bool isNested, Declaration& declaration) const
+{
+	if (GetToken(position).GetType() != TokenType::Ident)
+	{
+		ConsumeBadDeclarationRemnants(position, end, isNested);
+		return false;
+	}
+	declaration.m_Name = position++;
+	while (position < end && GetToken(position).GetType() == TokenType::Whitespace)
+	{
+		++position;
+	}
+	if (position == end || GetToken(position).GetType() != TokenType::Colon)
+	{
+		ConsumeBadDeclarationRemnants(position, end, isNested);
+		return false;
+	}
+	++position;
+	while (position < end && GetToken(position).GetType() == TokenType::Whitespace)
+	{
+		++position;
+	}
+	// The value is consumed like a list of component values stopped by a semicolon. The last two non-whitespace
+	// values are kept for !important.
+	const unsigned valueBegin = position;
+	unsigned last = end;
+	unsigned beforeLast = end;
+	unsigned nonWhitespaceCount = 0;
+	bool hasCurlyBlock = false;
+	while (position < end)
+	{
+		const TokenType type = GetToken(position).GetType();
+		if (type == TokenType::SemiColon || (type == TokenType::RightCurlyBracket && isNested))
+		{
+			break;
+		}
+		if (type != TokenType::Whitespace)
+		{
+			beforeLast = last;
+			last = position;
+			++nonWhitespaceCount;
+			hasCurlyBlock |= type == TokenType::LeftCurlyBracket;
+		}
+		position = SkipComponentValue(position, end);
+	}
+	unsigned valueEnd = position;
+	if (nonWhitespaceCount >= 2 && GetToken(beforeLast).GetType() == TokenType::Delim
+		&& GetToken(beforeLast).GetDelim().GetBytes() == '!' && GetToken(last).GetType() == TokenType::Ident
+		&& EqualsIgnoringASCIICase(m_Tokens.GetValue(GetToken(last)), "important"))
+	{
+		declaration.m_IsImportant = true;
+		valueEnd = beforeLast;
+		nonWhitespaceCount -= 2;
+	}
+	while (valueEnd > valueBegin && GetToken(valueEnd - 1).GetType() == TokenType::Whitespace)
+	{
+		--valueEnd;
+	}
+	declaration.m_Value = {valueBegin, valueEnd};
+	if (!IsCustomPropertyName(m_Tokens.GetValue(GetToken(declaration.m_Name))) && hasCurlyBlock && nonWhitespaceCount > 1)
+	{
+		return false;
+	}
+	return true;
+}
+
+// https://www.w3.org/TR/css-syntax-3/#consume-the-remnants-of-a-bad-declaration
+void StyleSheet::ConsumeBadDeclarationRemnants(unsigned& position, unsigned end, bool isNested) const
+{
+	while (position < end)
+	{
+		switch (GetToken(position).GetType())
+		{
+		case TokenType::SemiColon:
+			++position;
+			return;
+		case TokenType::RightCurlyBracket:
+			if (isNested)
+			{
+				return;
+			}
+			++position;
+			break;
+		default:
+			position = SkipComponentValue(position, end);
+			break;
+		}
+	}
+}
+}
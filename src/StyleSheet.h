@@ -0,0 +1,162 @@
+/*
+MIT License
+
+Copyright (c) 2024 omalinov
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#pragma once
+
+#include "CommonTypes.h"
+#include "Tokens.h"
+
+namespace css_parser
+{
+// Consecutive elements of an array, from m_Begin to before m_End: tokens of a TokenList, or rules, declarations
+// or component values of a StyleSheet.
+struct IndexRange
+{
+	unsigned m_Begin = 0;
+	unsigned m_End = 0;
+};
+
+enum class RuleType : unsigned char
+{
+	Qualified,
+	At,
+	// https://www.w3.org/TR/css-nesting-1/#nested-declarations-rule
+	// The declarations of a block that follow one of its nested rules. It has no prelude and no block.
+	NestedDeclarations
+};
+
+// https://www.w3.org/TR/css-syntax-3/#qualified-rule or https://www.w3.org/TR/css-syntax-3/#at-rule
+struct Rule
+{
+	RuleType m_Type = RuleType::Qualified;
+	// At-rules can end with a semicolon instead of a {} block.
+	bool m_HasBlock = false;
+	bool m_IsBlockParsed = false;
+	bool m_IsPreludeParsed = false;
+	// The <at-keyword-token> of an at-rule.
+	unsigned m_Name = 0;
+	// The tokens of the prelude, e.g. the selectors of a style rule.
+	IndexRange m_Prelude;
+	// The component values of the prelude once it is parsed, in StyleSheet::m_ComponentValues.
+	IndexRange m_PreludeValues;
+	// The tokens between the braces of the block.
+	IndexRange m_Block;
+	// The contents of the block once it is parsed, in StyleSheet::m_Declarations and StyleSheet::m_Rules.
+	// The declarations are the ones before the first nested rule, the others are in nested declarations rules.
+	IndexRange m_Declarations;
+	IndexRange m_ChildRules;
+};
+
+// https://www.w3.org/TR/css-syntax-3/#declaration
+struct Declaration
+{
+	// The <ident-token> of the name.
+	unsigned m_Name = 0;
+	// The tokens of the value, without the whitespace around it and without !important.
+	IndexRange m_Value;
+	// The component values of the value once it is parsed, in StyleSheet::m_ComponentValues.
+	IndexRange m_Values;
+	bool m_IsImportant = false;
+	bool m_IsValueParsed = false;
+};
+
+enum class ComponentValueType : unsigned char
+{
+	PreservedToken,
+	Function,
+	SimpleBlock
+};
+
+// https://www.w3.org/TR/css-syntax-3/#component-value
+struct ComponentValue
+{
+	ComponentValueType m_Type = ComponentValueType::PreservedToken;
+	// The preserved token, the <function-token> of a function, or the opening token of a simple block.
+	unsigned m_Token = 0;
+	// The component values of the arguments of a function or of the contents of a simple block,
+	// in StyleSheet::m_ComponentValues.
+	IndexRange m_Children;
+};
+
+// The rules of a stylesheet, parsed in two steps. The rules of the stylesheet itself and their preludes are parsed
+// when it is created, while the contents of a block are parsed only the first time they are asked for.
+// Blocks are most of a stylesheet and many are never looked at, e.g. the rules of a framework that a page does not use,
+// so until then they cost only their tokens: they are skipped with the partner index of their opening brace.
+// The same goes for the component values of preludes and declaration values, ParseAll parses everything at once.
+// Rules, declarations and component values are each stored in one array and refer to each other, and to the tokens,
+// by index. The children of a node are a range of consecutive elements, so there is no allocation per node.
+class StyleSheet
+{
+public:
+	// https://www.w3.org/TR/css-syntax-3/#parse-stylesheet
+	// tokens has to outlive the stylesheet and to come from TokenizeCodePoints or TokenizeUTF8, which pair the brackets.
+	explicit StyleSheet(const TokenList& tokens, MemoryResource* resource = std::pmr::get_default_resource());
+
+	const TokenList& GetTokens() const;
+	// The rules of the stylesheet itself.
+	IndexRange GetRules() const;
+	// Parsing a block adds its rules, which invalidates the references to the others.
+	const Rule& GetRule(unsigned index) const;
+	// The declarations and the nested rules of the block of a rule, which is parsed the first time either is asked for.
+	// The declarations that follow a nested rule are in nested declarations rules among the nested rules.
+	IndexRange GetDeclarations(unsigned ruleIndex);
+	IndexRange GetChildRules(unsigned ruleIndex);
+	const Declaration& GetDeclaration(unsigned index) const;
+	// The component values of the prelude of a rule and of the value of a declaration, parsed the first time they are
+	// asked for. Parsing component values adds some, which invalidates the references to the others.
+	IndexRange GetPreludeValues(unsigned ruleIndex);
+	IndexRange GetDeclarationValues(unsigned declarationIndex);
+	const ComponentValue& GetComponentValue(unsigned index) const;
+	// https://www.w3.org/TR/css-syntax-3/#parse-list-of-component-values
+	// tokens can be any range of the tokens of the stylesheet, e.g. the contents of a block of an at-rule that
+	// does not take rules nor declarations.
+	IndexRange ParseComponentValues(const IndexRange& tokens);
+	// Parses all the blocks, preludes and declaration values.
+	void ParseAll();
+private:
+	const Token& GetToken(unsigned index) const;
+	// The position past the component value at position, a whole block or function for their opening tokens.
+	unsigned SkipComponentValue(unsigned position, unsigned end) const;
+	void ParseBlock(unsigned ruleIndex);
+	IndexRange AppendComponentValues(unsigned position, unsigned end);
+
+	// The consume algorithms of https://www.w3.org/TR/css-syntax-3/#parser-algorithms over the tokens from position
+	// to end, where end stands for the <EOF-token>. They advance position past what they consume.
+	void ConsumeStyleSheetContents(unsigned position, unsigned end);
+	void ConsumeAtRule(unsigned& position, unsigned end, bool isNested, Rule& rule) const;
+	bool ConsumeQualifiedRule(unsigned& position, unsigned end, bool isNested, bool isStoppedBySemiColon, Rule& rule) const;
+	void ConsumeBlock(unsigned& position, unsigned end, Rule& rule) const;
+	// Returns the declarations before the first nested rule.
+	IndexRange ConsumeBlockContents(unsigned position, unsigned end);
+	void EndDeclarations(unsigned rulesBegin, unsigned& declarationsBegin, IndexRange& declarations);
+	bool ConsumeDeclaration(unsigned& position, unsigned end, bool isNested, Declaration& declaration) const;
+	void ConsumeBadDeclarationRemnants(unsigned& position, unsigned end, bool isNested) const;
+
+	const TokenList& m_Tokens;
+	Vector<Rule> m_Rules;
+	Vector<Declaration> m_Declarations;
+	Vector<ComponentValue> m_ComponentValues;
+	IndexRange m_StyleSheetRules;
+};
+}
@@ -24,30 +24,58 @@ SOFTWARE.
 
 #include "Tokens.h"
 #include "CSSParserAssert.h"
-#include <cmath>
+#include "Numbers.h"
 
 namespace css_parser
 {
-HashTokenValue::HashTokenValue(Vector<CodePoint>&& value, bool isID)
-	: m_Value(std::move(value))
-	, m_IsID(isID)
+NumberTokenValue::NumberTokenValue(int64_t value)
+	: m_Integer(value)
+	, m_IsInteger(true)
 {
 }
 
-NumberTokenValue::NumberTokenValue(FixedArray<Byte, BYTES_FOR_VALUE>&& value, bool isInteger)
-	: m_Value(std::move(value))
-	, m_IsInteger(isInteger)
+NumberTokenValue::NumberTokenValue(double value)
+	: m_Number(value)
+	, m_IsInteger(false)
 {
 }
 
-DimensionTokenValue::DimensionTokenValue(NumberTokenValue&& number, Vector<CodePoint>&& unit)
-	: m_Number(std::move(number))
-	, m_Unit(std::move(unit))
+bool NumberTokenValue::IsInteger() const
+{
+	return m_IsInteger;
+}
+
+int64_t NumberTokenValue::GetInteger() const
+{
+	CSS_PARSER_ASSERT(m_IsInteger, "The value is not an integer");
+	return m_Integer;
+}
+
+double NumberTokenValue::GetNumber() const
+{
+	return m_IsInteger ? static_cast<double>(m_Integer) : m_Number;
+}
+
+Token::Token()
+	: Token(TokenType::EndOfFile)
 {
 }
 
 Token::Token(TokenType type)
 	: m_Type(type)
+	, m_Flags(0)
+	, m_Offset(0)
+	, m_Length(0)
+	, m_Index(0)
+{
+}
+
+Token::Token(TokenType type, const TokenValue& value)
+	: m_Type(type)
+	, m_Flags(value.m_IsInPayload ? FLAG_IS_VALUE_IN_PAYLOAD : 0)
+	, m_Offset(value.m_Offset)
+	, m_Length(value.m_Length)
+	, m_Index(0)
 {
 }
 
@@ -68,32 +96,44 @@ Token Token::CreateBadURL()
 
 Token Token::CreateLeftParenthesis()
 {
-	return Token(TokenType::LeftParenthesis);
+	Token result(TokenType::LeftParenthesis);
+	result.m_Index = NO_PARTNER;
+	return result;
 }
 
 Token Token::CreateRightParenthesis()
 {
-	return Token(TokenType::RightParenthesis);
+	Token result(TokenType::RightParenthesis);
+	result.m_Index = NO_PARTNER;
+	return result;
 }
 
 Token Token::CreateLeftSquareBracket()
 {
-	return Token(TokenType::LeftSquareBracket);
+	Token result(TokenType::LeftSquareBracket);
+	result.m_Index = NO_PARTNER;
+	return result;
 }
 
 Token Token::CreateRightSquareBracket()
 {
-	return Token(TokenType::RightSquareBracket);
+	Token result(TokenType::RightSquareBracket);
+	result.m_Index = NO_PARTNER;
+	return result;
 }
 
 Token Token::CreateLeftCurlyBracket()
 {
-	return Token(TokenType::LeftCurlyBracket);
+	Token result(TokenType::LeftCurlyBracket);
+	result.m_Index = NO_PARTNER;
+	return result;
 }
 
 Token Token::CreateRightCurlyBracket()
 {
-	return Token(TokenType::RightCurlyBracket);
+	Token result(TokenType::RightCurlyBracket);
+	result.m_Index = NO_PARTNER;
+	return result;
 }
 
 Token Token::CreateComma()
@@ -124,119 +164,312 @@ Token Token::CreateCDO()
 Token Token::CreateDelim(const CodePoint& value)
 {
 	Token result(TokenType::Delim);
-	result.m_Value = value;
+	result.m_Index = value.GetBytes();
 	return result;
 }
 
-Token Token::CreateHash(HashTokenValue&& value)
+Token Token::CreateHash(const TokenValue& value, bool isID)
 {
-	Token result(TokenType::Hash);
-	result.m_Value = std::move(value);
+	Token result(TokenType::Hash, value);
+	if (isID)
+	{
+		result.m_Flags |= FLAG_IS_ID;
+	}
 	return result;
 }
 
-Token Token::CreateString(Vector<CodePoint>&& value)
+Token Token::CreateString(const TokenValue& value)
 {
-	Token result(TokenType::String);
-	result.m_Value = std::move(value);
-	return result;
+	return Token(TokenType::String, value);
 }
 
-Token Token::CreateNumber(NumberTokenValue&& value)
+Token Token::CreateNumber(unsigned numberIndex)
 {
 	Token result(TokenType::Number);
-	result.m_Value = std::move(value);
+	result.m_Index = numberIndex;
 	return result;
 }
 
-Token Token::CreatePercentage(NumberTokenValue&& value)
+Token Token::CreatePercentage(unsigned numberIndex)
 {
 	Token result(TokenType::Percentage);
-	result.m_Value = std::move(value);
+	result.m_Index = numberIndex;
 	return result;
 }
 
-Token Token::CreateDimension(DimensionTokenValue&& value)
+Token Token::CreateDimension(unsigned numberIndex, const TokenValue& unit)
 {
-	Token result(TokenType::Dimension);
-	result.m_Value = std::move(value);
+	Token result(TokenType::Dimension, unit);
+	result.m_Index = numberIndex;
 	return result;
 }
 
-Token Token::CreateFunction(Vector<CodePoint>&& value)
+Token Token::CreateFunction(const TokenValue& value)
 {
-	Token result(TokenType::Function);
-	result.m_Value = std::move(value);
+	Token result(TokenType::Function, value);
+	result.m_Index = NO_PARTNER;
 	return result;
 }
 
-Token Token::CreateIdent(Vector<CodePoint>&& value)
+Token Token::CreateIdent(const TokenValue& value)
 {
-	Token result(TokenType::Ident);
-	result.m_Value = std::move(value);
-	return result;
+	return Token(TokenType::Ident, value);
 }
 
-Token Token::CreateURL(Vector<CodePoint>&& value)
+Token Token::CreateURL(const TokenValue& value)
 {
-	Token result(TokenType::URL);
-	result.m_Value = std::move(value);
-	return result;
+	return Token(TokenType::URL, value);
+}
+
+Token Token::CreateAtKeyword(const TokenValue& value)
+{
+	return Token(TokenType::AtKeyword, value);
+}
+
+Token Token::CreateEOF()
+{
+	return Token(TokenType::EndOfFile);
+}
+
+TokenType Token::GetType() const
+{
+	return m_Type;
+}
+
+bool Token::IsID() const
+{
+	CSS_PARSER_ASSERT(m_Type == TokenType::Hash, "Only hash tokens have a type flag");
+	return (m_Flags & FLAG_IS_ID) != 0;
 }
 
-Token Token::CreateAtKeyword(Vector<CodePoint>&& value)
+CodePoint Token::GetDelim() const
 {
-	Token result(TokenType::AtKeyword);
-	result.m_Value = std::move(value);
+	CSS_PARSER_ASSERT(m_Type == TokenType::Delim, "Expects a delim token");
+	return CodePoint(m_Index);
+}
+
+TokenValue Token::GetValue() const
+{
+	TokenValue result;
+	result.m_Offset = m_Offset;
+	result.m_Length = m_Length;
+	result.m_IsInPayload = (m_Flags & FLAG_IS_VALUE_IN_PAYLOAD) != 0;
 	return result;
 }
 
-// https://www.w3.org/TR/css-syntax-3/#consume-comment
-bool ConsumeComments(const Vector<CodePoint>& inputStream, SizeType& position)
+unsigned Token::GetNumberIndex() const
+{
+	CSS_PARSER_ASSERT(m_Type == TokenType::Number || m_Type == TokenType::Percentage || m_Type == TokenType::Dimension,
+		"Expects a numeric token");
+	return m_Index;
+}
+
+unsigned Token::GetPartnerIndex() const
+{
+	CSS_PARSER_ASSERT(m_Type == TokenType::Function || (m_Type >= TokenType::LeftSquareBracket && m_Type <= TokenType::RightCurlyBracket),
+		"Expects a bracket or function token");
+	return m_Index;
+}
+
+void Token::SetPartnerIndex(unsigned index)
+{
+	CSS_PARSER_ASSERT(m_Type == TokenType::Function || (m_Type >= TokenType::LeftSquareBracket && m_Type <= TokenType::RightCurlyBracket),
+		"Expects a bracket or function token");
+	m_Index = index;
+}
+
+TokenList::TokenList(MemoryResource* resource)
+	: m_Tokens(resource)
+	, m_Numbers(resource)
+	, m_Payload(resource)
+	, m_Comments(resource)
+{
+}
+
+StringView TokenList::GetValue(const TokenValue& value) const
+{
+	const StringView storage = value.m_IsInPayload ? StringView(m_Payload) : m_Input;
+	return storage.substr(value.m_Offset, value.m_Length);
+}
+
+StringView TokenList::GetValue(const Token& token) const
+{
+	return GetValue(token.GetValue());
+}
+
+const NumberTokenValue& TokenList::GetNumber(const Token& token) const
+{
+	return m_Numbers[token.GetNumberIndex()];
+}
+
+void TokenList::Clear()
+{
+	m_Tokens.clear();
+	m_Numbers.clear();
+	m_Payload.clear();
+	m_Input = StringView();
+	m_Comments.clear();
+}
+
+void TokenList::ShrinkToFit()
 {
-	if (position + 1 >= inputStream.size())
+	m_Tokens.shrink_to_fit();
+	m_Numbers.shrink_to_fit();
+	m_Payload.shrink_to_fit();
+	m_Comments.shrink_to_fit();
+}
+
+// Builds the value of a token out of the code points consumed for it.
+// While they are consumed one after the other and are in the input unchanged, the value is a range of the input.
+// From the first one that is not, e.g. an escaped code point, the value is copied to the payload of the TokenList.
+template <typename InputStream>
+class TokenValueBuilder
+{
+public:
+	TokenValueBuilder(InputStream& inputStream, TokenList& tokens)
+		: m_InputStream(inputStream)
+		, m_Tokens(tokens)
+		, m_Start(inputStream.GetPosition())
+		, m_End(m_Start)
+		, m_PayloadStart(tokens.m_Payload.size())
+		, m_IsInPayload(!InputStream::CAN_REFERENCE_INPUT)
 	{
-		return true;
 	}
-	// If the next two input code point are U+002F SOLIDUS (/) followed by a U+002A ASTERISK (*)
-	if (inputStream[position] != CodePointValue::SOLIDUS || inputStream[position + 1] != CodePointValue::ASTERISK)
+
+	// Appends the next input code point to the value and consumes it.
+	void ConsumeNext()
 	{
-		return true;
+		if constexpr (InputStream::CAN_REFERENCE_INPUT)
+		{
+			if (!m_IsInPayload && m_InputStream.GetPosition() == m_End && m_InputStream.IsNextCodePointVerbatim())
+			{
+				m_InputStream.Advance();
+				m_End = m_InputStream.GetPosition();
+				return;
+			}
+		}
+		Append(m_InputStream.Peek());
+		m_InputStream.Advance();
+	}
+
+	void Append(const CodePoint& codePoint)
+	{
+		MoveToPayload();
+		AppendUTF8(codePoint, m_Tokens.m_Payload);
 	}
-	bool isPreviousAsterisk = false;
-	for (; position < inputStream.size(); ++position)
+
+	// Consumes and appends the code points of a string body that are neither endingCodePoint nor otherwise
+	// special, many bytes at a time. Does nothing when the input cannot be referenced.
+	void ConsumeStringBody(const CodePoint& endingCodePoint)
 	{
-		const CodePoint& codePoint = inputStream[position];
-		if (codePoint == CodePointValue::ASTERISK)
+		if constexpr (InputStream::CAN_REFERENCE_INPUT)
 		{
-			isPreviousAsterisk = true;
-			continue;
+			const SizeType start = m_InputStream.GetPosition();
+			AppendVerbatim(start, m_InputStream.SkipStringBody(static_cast<char>(endingCodePoint.GetBytes())));
+		}
+		else
+		{
+			UNUSED(endingCodePoint);
+		}
+	}
+
+	// Consumes and appends the run of ASCII ident code points ahead, many bytes at a time.
+	// Does nothing when the input cannot be referenced.
+	void ConsumeIdentRun()
+	{
+		if constexpr (InputStream::CAN_REFERENCE_INPUT)
+		{
+			const SizeType start = m_InputStream.GetPosition();
+			AppendVerbatim(start, m_InputStream.SkipIdentRun());
+		}
+	}
+
+	TokenValue GetValue() const
+	{
+		TokenValue result;
+		if (m_IsInPayload)
+		{
+			result.m_Offset = static_cast<unsigned>(m_PayloadStart);
+			result.m_Length = static_cast<unsigned>(m_Tokens.m_Payload.size() - m_PayloadStart);
+			result.m_IsInPayload = true;
+		}
+		else
+		{
+			result.m_Offset = static_cast<unsigned>(m_Start);
+			result.m_Length = static_cast<unsigned>(m_End - m_Start);
 		}
-		if (codePoint == CodePointValue::SOLIDUS)
+		return result;
+	}
+private:
+	// Appends length bytes of the input, from start, that are the UTF-8 encoding of the code points they were
+	// consumed as.
+	void AppendVerbatim(SizeType start, SizeType length)
+	{
+		if (length == 0)
+		{
+			return;
+		}
+		if (!m_IsInPayload && start == m_End)
+		{
+			m_End = start + length;
+			return;
+		}
+		MoveToPayload();
+		m_Tokens.m_Payload.append(m_InputStream.GetInput().data() + start, length);
+	}
+
+	void MoveToPayload()
+	{
+		if constexpr (InputStream::CAN_REFERENCE_INPUT)
 		{
-			if (isPreviousAsterisk)
+			if (!m_IsInPayload)
 			{
-				++position;
-				return true;
+				const StringView input = m_InputStream.GetInput();
+				m_Tokens.m_Payload.append(input.data() + m_Start, m_End - m_Start);
+				m_IsInPayload = true;
 			}
 		}
-		isPreviousAsterisk = false;
 	}
-	// If the preceding paragraph ended by consuming an EOF code point, this is a parse error.
-	return false;
-}
 
+	InputStream& m_InputStream;
+	TokenList& m_Tokens;
+	SizeType m_Start;
+	SizeType m_End;
+	SizeType m_PayloadStart;
+	bool m_IsInPayload;
+};
 
-void ConsumeWhitespace(const Vector<CodePoint>& inputStream, SizeType& position, FixedArray<Byte, sizeof(Token)>& output)
+// https://www.w3.org/TR/css-syntax-3/#consume-comment
+// Comment bodies are skipped with a vectorized search for their end. The ranges of the comments are appended
+// to comments unless it is null.
+template <typename InputStream>
+bool ConsumeComments(InputStream& inputStream, Vector<CommentRange>* comments)
 {
-	for (; position < inputStream.size(); ++position)
+	// If the next two input code point are U+002F SOLIDUS (/) followed by a U+002A ASTERISK (*)
+	while (inputStream.Peek() == CodePointValue::SOLIDUS && inputStream.Peek(1) == CodePointValue::ASTERISK)
 	{
-		if (!IsWhitespace(inputStream[position]))
+		CommentRange range;
+		range.m_Start = inputStream.GetPosition();
+		inputStream.Advance(2);
+		if (!inputStream.SkipCommentBody())
 		{
-			break;
+			// If the preceding paragraph ended by consuming an EOF code point, this is a parse error.
+			return false;
+		}
+		if (comments)
+		{
+			range.m_End = inputStream.GetPosition();
+			comments->push_back(range);
 		}
 	}
-	new (output.data()) Token(Token::CreateWhitespace());
+	return true;
+}
+
+template <typename InputStream>
+void ConsumeWhitespace(InputStream& inputStream, Token& output)
+{
+	inputStream.SkipWhitespace();
+	output = Token::CreateWhitespace();
 }
 
 unsigned HexDigitToNumber(const CodePoint& codePoint)
@@ -253,45 +486,32 @@ unsigned HexDigitToNumber(const CodePoint& codePoint)
 	return 10 + codePoint.GetBytes() - static_cast<unsigned>(CodePointValue::LATIN_CAPITAL_LETTER_A);
 }
 
-CodePoint HexSequenceToCodePoint(const Vector<CodePoint>& inputStream, SizeType start, SizeType count)
-{
-	unsigned resultBytes = 0;
-	for (SizeType i = 0; i < count; ++i)
-	{
-		const CodePoint& codePoint = inputStream[start + i];
-		const unsigned asNumber = HexDigitToNumber(codePoint);
-		resultBytes = (resultBytes << 4) | asNumber;
-	}
-	return CodePoint(resultBytes);
-}
-
 // https://www.w3.org/TR/css-syntax-3/#consume-an-escaped-code-point
-bool ConsumeEscapedCodePoint(const Vector<CodePoint>& inputStream, SizeType& position, FixedArray<Byte, sizeof(CodePoint)>& output)
+// It assumes that the U+005C REVERSE SOLIDUS (\) has already been consumed.
+template <typename InputStream>
+bool ConsumeEscapedCodePoint(InputStream& inputStream, FixedArray<Byte, sizeof(CodePoint)>& output)
 {
-	const SizeType startPosition = position;
-	if (position == inputStream.size())
+	const CodePoint codePoint = inputStream.Peek();
+	if (IsEOF(codePoint))
 	{
 		new (output.data()) CodePoint(CodePointValue::REPLACEMENT);
 		return false;
 	}
-	const CodePoint& codePoint = inputStream[position++];
+	inputStream.Advance();
 	if (IsHexDigit(codePoint))
 	{
-		SizeType consumed = 0;
-		for (; consumed < 5; ++consumed)
+		// Consume as many hex digits as possible, but no more than 5.
+		unsigned asNumber = HexDigitToNumber(codePoint);
+		for (SizeType consumed = 0; consumed < 5 && IsHexDigit(inputStream.Peek()); ++consumed)
 		{
-			if (!IsHexDigit(inputStream[position]))
-			{
-				break;
-			}
-			++position;
+			asNumber = (asNumber << 4) | HexDigitToNumber(inputStream.Peek());
+			inputStream.Advance();
 		}
-		if (IsWhitespace(inputStream[position]))
+		if (IsWhitespace(inputStream.Peek()))
 		{
-			++position;
+			inputStream.Advance();
 		}
-		const CodePoint asNumber = HexSequenceToCodePoint(inputStream, startPosition, consumed + 1);
-		if (asNumber == CodePointValue::ZERO || IsSurrogate(asNumber) || asNumber > CodePointValue::MAXIMUM_ALLOWED_CODE_POINT)
+		if (asNumber == 0 || IsSurrogate(CodePoint(asNumber)) || asNumber > static_cast<unsigned>(CodePointValue::MAXIMUM_ALLOWED_CODE_POINT))
 		{
 			new (output.data()) CodePoint(CodePointValue::REPLACEMENT);
 		}
@@ -306,409 +526,344 @@ bool ConsumeEscapedCodePoint(const Vector<CodePoint>& inputStream, SizeType& pos
 }
 
 // https://www.w3.org/TR/css-syntax-3/#consume-string-token
-bool ConsumeStringToken(const Vector<CodePoint>& inputStream,
-	SizeType& position,
-	FixedArray<Byte, sizeof(Token)>& output,
+template <typename InputStream>
+bool ConsumeStringToken(InputStream& inputStream,
+	TokenList& tokens,
+	Token& output,
 	const CodePoint& endingCodePoint)
 {
-	Vector<CodePoint> value;
-	while (position < inputStream.size())
+	TokenValueBuilder<InputStream> value(inputStream, tokens);
+	for (;;)
 	{
-		const CodePoint& nextCodePoint = inputStream[position++];
-		if (nextCodePoint == endingCodePoint)
+		// Long strings, e.g. data URLs, are mostly runs of ASCII code points with nothing to do but to append them.
+		value.ConsumeStringBody(endingCodePoint);
+		const CodePoint nextCodePoint = inputStream.Peek();
+		if (IsEOF(nextCodePoint))
 		{
-			new (output.data()) Token(Token::CreateString(std::move(value)));
-			return true;
+			output = Token::CreateString(value.GetValue());
+			return false;
 		}
-		else if (IsNewline(nextCodePoint))
+		if (IsNewline(nextCodePoint))
 		{
-			--position;
-			new (output.data()) Token(Token::CreateBadString());
+			output = Token::CreateBadString();
 			return false;
 		}
+		if (nextCodePoint == endingCodePoint)
+		{
+			inputStream.Advance();
+			output = Token::CreateString(value.GetValue());
+			return true;
+		}
 		else if (nextCodePoint == CodePointValue::REVERSE_SOLIDUS)
 		{
-			if (position == inputStream.size())
+			inputStream.Advance();
+			const CodePoint escapedCodePoint = inputStream.Peek();
+			if (IsEOF(escapedCodePoint))
 			{
 				// If the next input code point is EOF, do nothing.
 				continue;
 			}
-			const CodePoint& nextCodePoint = inputStream[position];
-			if (IsNewline(nextCodePoint))
+			if (IsNewline(escapedCodePoint))
 			{
 				// Otherwise, if the next input code point is a newline, consume it.
-				++position;
+				inputStream.Advance();
 				continue;
 			}
 			FixedArray<Byte, sizeof(CodePoint)> escapedCodePointRaw;
-			if (!ConsumeEscapedCodePoint(inputStream, position, escapedCodePointRaw))
+			if (!ConsumeEscapedCodePoint(inputStream, escapedCodePointRaw))
 			{
 				return false;
 			}
-			value.push_back(*(reinterpret_cast<CodePoint*>(escapedCodePointRaw.data())));
+			value.Append(*(reinterpret_cast<CodePoint*>(escapedCodePointRaw.data())));
 		}
 		else
 		{
-			value.push_back(nextCodePoint);
+			value.ConsumeNext();
 		}
 	}
-	// EOF
-	new (output.data()) Token(Token::CreateString(std::move(value)));
-	return false;
 }
 
 // https://www.w3.org/TR/css-syntax-3/#check-if-two-code-points-are-a-valid-escape
-bool AreTwoCodePointsValidEscape(const Vector<CodePoint>& inputStream, SizeType position)
+bool AreTwoCodePointsValidEscape(const CodePoint& first, const CodePoint& second)
 {
-	if (position + 1 >= inputStream.size())
-	{
-		return false;
-	}
-	if (inputStream[position] != CodePointValue::REVERSE_SOLIDUS)
-	{
-		return false;
-	}
-	return !IsNewline(inputStream[position + 1]);
+	return first == CodePointValue::REVERSE_SOLIDUS && !IsNewline(second) && !IsEOF(second);
 }
 
 // https://www.w3.org/TR/css-syntax-3/#check-if-three-code-points-would-start-an-ident-sequence
-bool DoThreeCodePointsStartIndentSequence(const Vector<CodePoint>& inputStream, SizeType position)
+bool DoThreeCodePointsStartIndentSequence(const CodePoint& first, const CodePoint& second, const CodePoint& third)
 {
-	if (position + 2 >= inputStream.size())
-	{
-		return false;
-	}
-	const CodePoint& firstCodePoint = inputStream[position];
-	if (firstCodePoint == CodePointValue::HYPHEN_MINUS)
+	if (first == CodePointValue::HYPHEN_MINUS)
 	{
-		return IsIdentStart(inputStream[position + 1])
-			|| inputStream[position + 1] == CodePointValue::HYPHEN_MINUS
-			|| AreTwoCodePointsValidEscape(inputStream, position + 1);
+		return IsIdentStart(second)
+			|| second == CodePointValue::HYPHEN_MINUS
+			|| AreTwoCodePointsValidEscape(second, third);
 	}
-	else if (firstCodePoint == CodePointValue::REVERSE_SOLIDUS)
+	else if (first == CodePointValue::REVERSE_SOLIDUS)
 	{
-		return AreTwoCodePointsValidEscape(inputStream, position);
+		return AreTwoCodePointsValidEscape(first, second);
 	}
-	return IsIdentStart(firstCodePoint);
+	return IsIdentStart(first);
 }
 
 // https://www.w3.org/TR/css-syntax-3/#consume-an-ident-sequence
-bool ConsumeIdentSequence(const Vector<CodePoint>& inputStream, SizeType& position, Vector<CodePoint>& result)
+template <typename InputStream>
+bool ConsumeIdentSequence(InputStream& inputStream, TokenValueBuilder<InputStream>& result)
 {
-	Vector<CodePoint> resultLocal;
-	while (position < inputStream.size())
+	for (;;)
 	{
-		const CodePoint& nextCodePoint = inputStream[position];
+		// Most ident sequences are ASCII ident code points only.
+		result.ConsumeIdentRun();
+		const CodePoint nextCodePoint = inputStream.Peek();
 		if (IsIdent(nextCodePoint))
 		{
-			resultLocal.push_back(nextCodePoint);
-			++position;
+			result.ConsumeNext();
 		}
-		else if (AreTwoCodePointsValidEscape(inputStream, position))
+		else if (AreTwoCodePointsValidEscape(nextCodePoint, inputStream.Peek(1)))
 		{
-			++position;
+			inputStream.Advance();
 			FixedArray<Byte, sizeof(CodePoint)> escapedCodePoint;
-			if (!ConsumeEscapedCodePoint(inputStream, position, escapedCodePoint))
+			if (!ConsumeEscapedCodePoint(inputStream, escapedCodePoint))
 			{
 				return false;
 			}
-			resultLocal.push_back(*reinterpret_cast<CodePoint*>(escapedCodePoint.data()));
-
+			result.Append(*reinterpret_cast<CodePoint*>(escapedCodePoint.data()));
 		}
 		else
 		{
 			break;
 		}
 	}
-	result = std::move(resultLocal);
 	return true;
 }
 
 // https://www.w3.org/TR/css-syntax-3/#starts-with-a-number
-bool DoThreeCodePointsStartNumber(const Vector<CodePoint>& inputStream, SizeType position)
+bool DoThreeCodePointsStartNumber(const CodePoint& first, const CodePoint& second, const CodePoint& third)
 {
-	if (position >= inputStream.size())
-	{
-		return false;
-	}
-	const CodePoint& firstCodePoint = inputStream[position];
-	if (firstCodePoint == CodePointValue::PLUS_SIGN || firstCodePoint == CodePointValue::HYPHEN_MINUS)
+	if (first == CodePointValue::PLUS_SIGN || first == CodePointValue::HYPHEN_MINUS)
 	{
-		if (position + 1 < inputStream.size() && IsDigit(inputStream[position + 1]))
+		if (IsDigit(second))
 		{
 			return true;
 		}
-		return position + 2 < inputStream.size()
-			&& inputStream[position + 1] == CodePointValue::FULL_STOP
-			&& IsDigit(inputStream[position + 2]);
+		return second == CodePointValue::FULL_STOP && IsDigit(third);
 	}
-	else if (firstCodePoint == CodePointValue::FULL_STOP)
+	else if (first == CodePointValue::FULL_STOP)
 	{
-		return position + 1 < inputStream.size() && IsDigit(inputStream[position + 1]);
+		return IsDigit(second);
 	}
-	return IsDigit(firstCodePoint);
+	return IsDigit(first);
 }
 
-// https://www.w3.org/TR/css-syntax-3/#convert-a-string-to-a-number
-FixedArray<Byte, NumberTokenValue::BYTES_FOR_VALUE> ConvertStringToNumber(const Vector<CodePoint>& string)
+// Consumes the digits at the start of the input stream into number.
+template <typename InputStream>
+void ConsumeDigits(InputStream& inputStream, DecimalNumber& number, bool isFraction)
 {
-	const auto InterpretAsBase10Number = [&string](SizeType& position, unsigned* numDigits = nullptr)
-	{
-		const SizeType start = position;
-		++position;
-		while (position < string.size() && IsDigit(string[position]))
-		{
-			++position;
-		}
-		if (numDigits)
-		{
-			*numDigits = static_cast<unsigned>(position - start);
-		}
-		unsigned result = 0;
-		unsigned base = 1;
-		for (SizeType i = position; i-- > start;)
-		{
-			result += (string[i].GetBytes() - static_cast<unsigned>(CodePointValue::ZERO)) * base;
-			base *= 10;
-		}
-		return result;
-	};
-	int s = 1, t = 1;
-	int64_t i = 0;
-	unsigned f = 0, d = 0, e = 0;
-	SizeType position = 0;
-	bool isInteger = true;
-	if (string[position] == CodePointValue::PLUS_SIGN)
-	{
-		++position;
-	}
-	else if (string[position] == CodePointValue::HYPHEN_MINUS)
-	{
-		s = -1;
-		++position;
-	}
-	if (IsDigit(string[position]))
-	{
-		i = InterpretAsBase10Number(position);
-	}
-	if (position < string.size() && string[position] == CodePointValue::FULL_STOP)
-	{
-		isInteger = false;
-		++position;
-	}
-	if (position < string.size() && IsDigit(string[position]))
-	{
-		CSS_PARSER_ASSERT(!isInteger, "Expected full stop before digit when parsing floating number");
-		f = InterpretAsBase10Number(position, &d);
-	}
-	if (position < string.size() &&
-		(string[position] == CodePointValue::LATIN_CAPITAL_LETTER_E ||
-			string[position] == CodePointValue::LATIN_SMALL_LETTER_E))
-	{
-		++position;
-	}
-	if (position < string.size())
-	{
-		if (string[position] == CodePointValue::PLUS_SIGN)
-		{
-			++position;
-		}
-		else if (string[position] == CodePointValue::HYPHEN_MINUS)
-		{
-			t = -1;
-			isInteger = false;
-			++position;
-		}
-	}
-	if (position < string.size() && IsDigit(string[position]))
-	{
-		e = InterpretAsBase10Number(position, &d);
-	}
-	FixedArray<Byte, NumberTokenValue::BYTES_FOR_VALUE> result;
-	if (isInteger)
-	{
-		CSS_PARSER_ASSERT(f == d == 0 && t == 1, "Bad number conversion");
-		int64_t resultNum = s * i;
-		int64_t exponentPow = 1;
-		for (int64_t j = 0; j < e; ++j)
-		{
-			exponentPow *= 10;
-		}
-		resultNum *= exponentPow;
-		new (result.data()) int64_t(resultNum);
-	}
-	else
+	for (CodePoint nextCodePoint = inputStream.Peek(); IsDigit(nextCodePoint); nextCodePoint = inputStream.Peek())
 	{
-		new (result.data()) double(s * (i + f * std::pow(10, d)) * std::pow(10, t * e));
+		AppendDigit(number, nextCodePoint.GetBytes() - static_cast<unsigned>(CodePointValue::ZERO), isFraction);
+		inputStream.Advance();
 	}
-	return result;
 }
 
 // https://www.w3.org/TR/css-syntax-3/#consume-number
-bool ConsumeNumber(const Vector<CodePoint>& inputStream, SizeType& position, FixedArray<Byte, sizeof(NumberTokenValue)>& output)
+// The digits are converted to a number as they are consumed
+// (https://www.w3.org/TR/css-syntax-3/#convert-a-string-to-a-number), without collecting the repr first.
+// Only the numbers that Clinger's fast path cannot convert exactly have their repr collected, in a second pass.
+template <typename InputStream>
+bool ConsumeNumber(InputStream& inputStream, TokenList& tokens)
 {
-	if (position == inputStream.size())
-	{
-		return false;
-	}
+	const SizeType start = inputStream.GetPosition();
 	bool isInteger = true;
-	Vector<CodePoint> repr;
+	DecimalNumber number;
 	{
-		const CodePoint& nextCodePoint = inputStream[position];
+		const CodePoint nextCodePoint = inputStream.Peek();
 		if (nextCodePoint == CodePointValue::PLUS_SIGN || nextCodePoint == CodePointValue::HYPHEN_MINUS)
 		{
-			++position;
-			repr.push_back(nextCodePoint);
+			number.m_IsNegative = nextCodePoint == CodePointValue::HYPHEN_MINUS;
+			inputStream.Advance();
 		}
 	}
-	while (position < inputStream.size())
+	ConsumeDigits(inputStream, number, false);
+	if (inputStream.Peek() == CodePointValue::FULL_STOP && IsDigit(inputStream.Peek(1)))
 	{
-		const CodePoint& nextCodePoint = inputStream[position];
-		if (!IsDigit(nextCodePoint))
-		{
-			break;
-		}
-		repr.push_back(nextCodePoint);
-		++position;
+		inputStream.Advance();
+		isInteger = false;
+		ConsumeDigits(inputStream, number, true);
 	}
-	if (position + 1 < inputStream.size())
+	const CodePoint exponent = inputStream.Peek();
+	if (exponent == CodePointValue::LATIN_CAPITAL_LETTER_E || exponent == CodePointValue::LATIN_SMALL_LETTER_E)
 	{
-		if (inputStream[position] == CodePointValue::FULL_STOP && IsDigit(inputStream[position + 1]))
+		const CodePoint afterExponent = inputStream.Peek(1);
+		bool isExponentNegative = false;
+		SizeType exponentStart = 0;
+		if ((afterExponent == CodePointValue::PLUS_SIGN || afterExponent == CodePointValue::HYPHEN_MINUS)
+			&& IsDigit(inputStream.Peek(2)))
+		{
+			isExponentNegative = afterExponent == CodePointValue::HYPHEN_MINUS;
+			exponentStart = 2;
+		}
+		else if (IsDigit(afterExponent))
+		{
+			exponentStart = 1;
+		}
+		if (exponentStart > 0)
 		{
-			repr.push_back(inputStream[position++]);
-			repr.push_back(inputStream[position++]);
+			inputStream.Advance(exponentStart);
 			isInteger = false;
-			while (position < inputStream.size() && IsDigit(inputStream[position]))
+			int exponentValue = 0;
+			for (CodePoint nextCodePoint = inputStream.Peek(); IsDigit(nextCodePoint); nextCodePoint = inputStream.Peek())
 			{
-				repr.push_back(inputStream[position++]);
+				if (exponentValue < DecimalNumber::MAX_EXPONENT)
+				{
+					exponentValue = exponentValue * 10 + static_cast<int>(nextCodePoint.GetBytes() - static_cast<unsigned>(CodePointValue::ZERO));
+				}
+				inputStream.Advance();
 			}
+			number.m_Exponent += isExponentNegative ? -exponentValue : exponentValue;
 		}
 	}
-	if (position + 1 < inputStream.size())
+	if (isInteger)
+	{
+		tokens.m_Numbers.emplace_back(ConvertDecimalToInteger(number));
+		return true;
+	}
+	double value = 0.0;
+	if (!ConvertDecimalToDoubleFast(number, value))
 	{
-		if (inputStream[position] == CodePointValue::LATIN_CAPITAL_LETTER_E ||
-			inputStream[position] == CodePointValue::LATIN_SMALL_LETTER_E)
+		// Numbers are made only of ASCII code points.
+		const SizeType end = inputStream.GetPosition();
+		String repr(tokens.m_Payload.get_allocator());
+		inputStream.SetPosition(start);
+		while (inputStream.GetPosition() != end)
 		{
-			if (inputStream[position + 1] == CodePointValue::PLUS_SIGN ||
-				inputStream[position + 1] == CodePointValue::HYPHEN_MINUS)
-			{
-				if (position + 2 < inputStream.size() && IsDigit(inputStream[position + 2]))
-				{
-					repr.push_back(inputStream[position++]);
-					repr.push_back(inputStream[position++]);
-					repr.push_back(inputStream[position++]);
-					isInteger = false;
-					while (position < inputStream.size() && IsDigit(inputStream[position]))
-					{
-						repr.push_back(inputStream[position++]);
-					}
-				}
-			}
-			else if (IsDigit(inputStream[position + 1]))
-			{
-				repr.push_back(inputStream[position++]);
-				repr.push_back(inputStream[position++]);
-				isInteger = false;
-				while (position < inputStream.size() && IsDigit(inputStream[position]))
-				{
-					repr.push_back(inputStream[position++]);
-				}
-			}
+			repr.push_back(static_cast<char>(inputStream.Peek().GetBytes()));
+			inputStream.Advance();
 		}
+		value = ConvertStringToDouble(number, repr);
 	}
-	FixedArray<Byte, NumberTokenValue::BYTES_FOR_VALUE> value = ConvertStringToNumber(repr);
-	new (output.data()) NumberTokenValue(std::move(value), isInteger);
+	tokens.m_Numbers.emplace_back(value);
 	return true;
 }
 
 // https://www.w3.org/TR/css-syntax-3/#consume-numeric-token
-bool ConsumeNumericToken(const Vector<CodePoint>& inputStream, SizeType& position, FixedArray<Byte, sizeof(Token)>& output)
+template <typename InputStream>
+bool ConsumeNumericToken(InputStream& inputStream, TokenList& tokens, Token& output)
 {
-	FixedArray<Byte, sizeof(NumberTokenValue)> number;
-	if (!ConsumeNumber(inputStream, position, number))
+	if (!ConsumeNumber(inputStream, tokens))
 	{
 		return false;
 	}
-	if (DoThreeCodePointsStartIndentSequence(inputStream, position))
+	const unsigned numberIndex = static_cast<unsigned>(tokens.m_Numbers.size() - 1);
+	if (DoThreeCodePointsStartIndentSequence(inputStream.Peek(), inputStream.Peek(1), inputStream.Peek(2)))
 	{
-		Vector<CodePoint> unit;
-		if (!ConsumeIdentSequence(inputStream, position, unit))
+		TokenValueBuilder<InputStream> unit(inputStream, tokens);
+		if (!ConsumeIdentSequence(inputStream, unit))
 		{
 			return false;
 		}
-		DimensionTokenValue dimension(std::move(*reinterpret_cast<NumberTokenValue*>(number.data())), std::move(unit));
-		new (output.data()) Token(Token::CreateDimension(std::move(dimension)));
+		output = Token::CreateDimension(numberIndex, unit.GetValue());
 		return true;
 	}
-	if (inputStream[position] == CodePointValue::PERCENTAGE_SIGN)
+	if (inputStream.Peek() == CodePointValue::PERCENTAGE_SIGN)
 	{
-		++position;
-		new (output.data()) Token(Token::CreatePercentage(std::move(*reinterpret_cast<NumberTokenValue*>(number.data()))));
+		inputStream.Advance();
+		output = Token::CreatePercentage(numberIndex);
 		return true;
 	}
-	new (output.data()) Token(Token::CreateNumber(std::move(*reinterpret_cast<NumberTokenValue*>(number.data()))));
+	output = Token::CreateNumber(numberIndex);
 	return true;
 }
 
 // https://www.w3.org/TR/css-syntax-3/#consume-the-remnants-of-a-bad-url
-bool ConsumeRemnantsOfBadURL(const Vector<CodePoint>& inputStream, SizeType& position)
+template <typename InputStream>
+bool ConsumeRemnantsOfBadURL(InputStream& inputStream)
 {
-	for (; position < inputStream.size(); ++position)
+	for (;;)
 	{
-		if (inputStream[position] == CodePointValue::RIGHT_PARENTHESIS)
+		const CodePoint next = inputStream.Peek();
+		if (IsEOF(next))
+		{
+			return true;
+		}
+		inputStream.Advance();
+		if (next == CodePointValue::RIGHT_PARENTHESIS)
 		{
 			return true;
 		}
-		else if (AreTwoCodePointsValidEscape(inputStream, position))
+		else if (AreTwoCodePointsValidEscape(next, inputStream.Peek()))
 		{
 			FixedArray<Byte, sizeof(CodePoint)> dummy;
-			if (!ConsumeEscapedCodePoint(inputStream, position, dummy))
+			if (!ConsumeEscapedCodePoint(inputStream, dummy))
 			{
 				return false;
 			}
-			continue;
 		}
 	}
-	return true;
+}
+
+// Whether consuming codePoint in a url is something else than appending it to the value of the token.
+bool IsURLSpecial(const CodePoint& codePoint)
+{
+	return codePoint == CodePointValue::RIGHT_PARENTHESIS
+		|| IsWhitespace(codePoint)
+		|| codePoint == CodePointValue::QUOTATION_MARK
+		|| codePoint == CodePointValue::APOSTROPHE
+		|| codePoint == CodePointValue::LEFT_PARENTHESIS
+		|| IsNonPrintable(codePoint)
+		|| codePoint == CodePointValue::REVERSE_SOLIDUS;
 }
 
 // https://www.w3.org/TR/css-syntax-3/#consume-url-token
-bool ConsumeURL(const Vector<CodePoint>& inputStream, SizeType& position, FixedArray<Byte, sizeof(Token)>& output)
+template <typename InputStream>
+bool ConsumeURL(InputStream& inputStream, TokenList& tokens, Token& output)
 {
-	Vector<CodePoint> value;
-	while (position < inputStream.size() && IsWhitespace(inputStream[position]))
+	while (IsWhitespace(inputStream.Peek()))
 	{
-		++position;
+		inputStream.Advance();
 	}
-	while (position < inputStream.size())
+	TokenValueBuilder<InputStream> value(inputStream, tokens);
+	for (;;)
 	{
-		const CodePoint& next = inputStream[position++];
+		const CodePoint next = inputStream.Peek();
+		if (IsEOF(next))
+		{
+			output = Token::CreateURL(value.GetValue());
+			return false;
+		}
+		if (!IsURLSpecial(next))
+		{
+			value.ConsumeNext();
+			continue;
+		}
+		inputStream.Advance();
 		if (next == CodePointValue::RIGHT_PARENTHESIS)
 		{
-			new (output.data()) Token(Token::CreateURL(std::move(value)));
+			output = Token::CreateURL(value.GetValue());
 			return true;
 		}
 		else if (IsWhitespace(next))
 		{
-			while (position < inputStream.size() && IsWhitespace(inputStream[position]))
+			while (IsWhitespace(inputStream.Peek()))
 			{
-				++position;
+				inputStream.Advance();
 			}
-			if (position == inputStream.size())
+			const CodePoint afterWhitespace = inputStream.Peek();
+			if (IsEOF(afterWhitespace))
 			{
-				break;
+				output = Token::CreateURL(value.GetValue());
+				return false;
 			}
-			if (inputStream[position] == CodePointValue::RIGHT_PARENTHESIS)
+			if (afterWhitespace == CodePointValue::RIGHT_PARENTHESIS)
 			{
-				++position;
-				new (output.data()) Token(Token::CreateURL(std::move(value)));
+				inputStream.Advance();
+				output = Token::CreateURL(value.GetValue());
 				return true;
 			}
-			if (!ConsumeRemnantsOfBadURL(inputStream, position))
+			if (!ConsumeRemnantsOfBadURL(inputStream))
 			{
 				return false;
 			}
-			new (output.data()) Token(Token::CreateBadURL());
+			output = Token::CreateBadURL();
 			return true;
 		}
 		else if (next == CodePointValue::QUOTATION_MARK
@@ -716,304 +871,895 @@ bool ConsumeURL(const Vector<CodePoint>& inputStream, SizeType& position, FixedA
 			|| next == CodePointValue::LEFT_PARENTHESIS
 			|| IsNonPrintable(next))
 		{
-			if (!ConsumeRemnantsOfBadURL(inputStream, position))
+			if (!ConsumeRemnantsOfBadURL(inputStream))
 			{
 				return false;
 			}
-			new (output.data()) Token(Token::CreateBadURL());
+			output = Token::CreateBadURL();
 			return true;
 		}
-		else if (next == CodePointValue::REVERSE_SOLIDUS)
+		else
 		{
-			if (AreTwoCodePointsValidEscape(inputStream, position - 1))
+			CSS_PARSER_ASSERT(next == CodePointValue::REVERSE_SOLIDUS, "Unexpected code point in a url");
+			if (AreTwoCodePointsValidEscape(next, inputStream.Peek()))
 			{
 				FixedArray<Byte, sizeof(CodePoint)> escapedCodePoint;
-				if (!ConsumeEscapedCodePoint(inputStream, position, escapedCodePoint))
+				if (!ConsumeEscapedCodePoint(inputStream, escapedCodePoint))
 				{
 					return false;
 				}
-				value.push_back(*(reinterpret_cast<CodePoint*>(escapedCodePoint.data())));
+				value.Append(*(reinterpret_cast<CodePoint*>(escapedCodePoint.data())));
 				continue;
 			}
-			if (!ConsumeRemnantsOfBadURL(inputStream, position))
+			if (!ConsumeRemnantsOfBadURL(inputStream))
 			{
 				return false;
 			}
-			new (output.data()) Token(Token::CreateBadURL());
+			output = Token::CreateBadURL();
 			return true;
 		}
-		else
-		{
-			value.push_back(next);
-		}
 	}
-	return false;
+}
+
+bool IsQuotationMarkOrApostrophe(const CodePoint& codePoint)
+{
+	return codePoint == CodePointValue::QUOTATION_MARK || codePoint == CodePointValue::APOSTROPHE;
 }
 
 // https://www.w3.org/TR/css-syntax-3/#consume-ident-like-token
-bool ConsumeIdentLikeToken(const Vector<CodePoint>& inputStream, SizeType& position, FixedArray<Byte, sizeof(Token)>& output)
+template <typename InputStream>
+bool ConsumeIdentLikeToken(InputStream& inputStream, TokenList& tokens, Token& output)
 {
-	Vector<CodePoint> string;
-	if (!ConsumeIdentSequence(inputStream, position, string))
+	TokenValueBuilder<InputStream> stringBuilder(inputStream, tokens);
+	if (!ConsumeIdentSequence(inputStream, stringBuilder))
 	{
 		return false;
 	}
-	if (string.size() == 3 &&
-		(string[0] == CodePointValue::LATIN_SMALL_LETTER_U || string[0] == CodePointValue::LATIN_CAPITAL_LETTER_U) &&
-		(string[1] == CodePointValue::LATIN_SMALL_LETTER_R || string[1] == CodePointValue::LATIN_CAPITAL_LETTER_R) &&
-		(string[2] == CodePointValue::LATIN_SMALL_LETTER_L || string[2] == CodePointValue::LATIN_CAPITAL_LETTER_L) &&
-		position < inputStream.size() &&
-		inputStream[position] == CodePointValue::LEFT_PARENTHESIS)
+	const TokenValue string = stringBuilder.GetValue();
+	const StringView name = tokens.GetValue(string);
+	if (name.size() == 3 &&
+		(name[0] == 'u' || name[0] == 'U') &&
+		(name[1] == 'r' || name[1] == 'R') &&
+		(name[2] == 'l' || name[2] == 'L') &&
+		inputStream.Peek() == CodePointValue::LEFT_PARENTHESIS)
 	{
-		++position;
-		while (position + 1 < inputStream.size() && IsWhitespace(inputStream[position]) && IsWhitespace(inputStream[position + 1]))
+		inputStream.Advance();
+		while (IsWhitespace(inputStream.Peek()) && IsWhitespace(inputStream.Peek(1)))
 		{
-			++position;
+			inputStream.Advance();
 		}
-		if (position + 1 < inputStream.size())
+		const CodePoint next = inputStream.Peek();
+		if (IsQuotationMarkOrApostrophe(next) ||
+			(IsWhitespace(next) && IsQuotationMarkOrApostrophe(inputStream.Peek(1))))
 		{
-			const CodePoint& next = inputStream[position];
-			const CodePoint& afterNext = inputStream[position + 1];
-			if ((next == CodePointValue::QUOTATION_MARK && afterNext == CodePointValue::APOSTROPHE) ||
-				(IsWhitespace(next) && (afterNext == CodePointValue::QUOTATION_MARK || afterNext == CodePointValue::APOSTROPHE)))
-			{
-				new (output.data()) Token(Token::CreateFunction(std::move(string)));
-				return true;
-			}
+			output = Token::CreateFunction(string);
+			return true;
 		}
-		return ConsumeURL(inputStream, position, output);
+		return ConsumeURL(inputStream, tokens, output);
 	}
-	else if (position < inputStream.size() && inputStream[position] == CodePointValue::LEFT_PARENTHESIS)
+	else if (inputStream.Peek() == CodePointValue::LEFT_PARENTHESIS)
 	{
-		new (output.data()) Token(Token::CreateFunction(std::move(string)));
+		inputStream.Advance();
+		output = Token::CreateFunction(string);
 		return true;
 	}
-	new (output.data()) Token(Token::CreateIdent(std::move(string)));
+	output = Token::CreateIdent(string);
 	return true;
 }
 
-bool ConsumeToken(const Vector<CodePoint>& inputStream, SizeType& position, FixedArray<Byte, sizeof(Token)>& output)
+// What ConsumeToken does with the first code point of a token.
+enum class TokenStart : unsigned char
 {
-	if (!ConsumeComments(inputStream, position))
+	Delim,
+	Whitespace,
+	QuotationMark,
+	NumberSign,
+	Apostrophe,
+	LeftParenthesis,
+	RightParenthesis,
+	PlusSign,
+	Comma,
+	HyphenMinus,
+	FullStop,
+	Colon,
+	SemiColon,
+	LessThanSign,
+	CommercialAt,
+	LeftSquareBracket,
+	ReverseSolidus,
+	RightSquareBracket,
+	LeftCurlyBracket,
+	RightCurlyBracket,
+	Digit,
+	IdentStart
+};
+
+constexpr FixedArray<TokenStart, 256> CreateTokenStarts()
+{
+	FixedArray<TokenStart, 256> tokenStarts{};
+	for (unsigned value = 0; value < tokenStarts.size(); ++value)
 	{
-		return false;
+		const unsigned short classes = CHARACTER_CLASSES[value];
+		if (classes & CharacterClass::WHITESPACE)
+		{
+			tokenStarts[value] = TokenStart::Whitespace;
+		}
+		else if (classes & CharacterClass::DIGIT)
+		{
+			tokenStarts[value] = TokenStart::Digit;
+		}
+		else if (classes & CharacterClass::IDENT_START)
+		{
+			tokenStarts[value] = TokenStart::IdentStart;
+		}
+		else
+		{
+			tokenStarts[value] = TokenStart::Delim;
+		}
 	}
-	if (position == inputStream.size())
+	tokenStarts['"'] = TokenStart::QuotationMark;
+	tokenStarts['#'] = TokenStart::NumberSign;
+	tokenStarts['\''] = TokenStart::Apostrophe;
+	tokenStarts['('] = TokenStart::LeftParenthesis;
+	tokenStarts[')'] = TokenStart::RightParenthesis;
+	tokenStarts['+'] = TokenStart::PlusSign;
+	tokenStarts[','] = TokenStart::Comma;
+	tokenStarts['-'] = TokenStart::HyphenMinus;
+	tokenStarts['.'] = TokenStart::FullStop;
+	tokenStarts[':'] = TokenStart::Colon;
+	tokenStarts[';'] = TokenStart::SemiColon;
+	tokenStarts['<'] = TokenStart::LessThanSign;
+	tokenStarts['@'] = TokenStart::CommercialAt;
+	tokenStarts['['] = TokenStart::LeftSquareBracket;
+	tokenStarts['\\'] = TokenStart::ReverseSolidus;
+	tokenStarts[']'] = TokenStart::RightSquareBracket;
+	tokenStarts['{'] = TokenStart::LeftCurlyBracket;
+	tokenStarts['}'] = TokenStart::RightCurlyBracket;
+	return tokenStarts;
+}
+
+constexpr FixedArray<TokenStart, 256> TOKEN_STARTS = CreateTokenStarts();
+
+TokenStart GetTokenStart(const CodePoint& codePoint)
+{
+	const unsigned value = codePoint.GetBytes();
+	if (value < 0x80)
 	{
-		// EOF
-		return true;
+		return TOKEN_STARTS[value];
 	}
-	const CodePoint& nextCodePoint = inputStream[position++];
-	if (IsWhitespace(nextCodePoint))
+	// Non-ASCII code points are ident-start code points.
+	return TokenStart::IdentStart;
+}
+
+// https://www.w3.org/TR/css-syntax-3/#consume-token
+// The branches of the spec are selected through the TOKEN_STARTS table instead of comparing
+// the code point against each of them in turn.
+template <typename InputStream>
+bool ConsumeToken(InputStream& inputStream, TokenList& tokens, Token& output, const TokenizerOptions& options)
+{
+	if (!ConsumeComments(inputStream, options.m_IsReportingComments ? &tokens.m_Comments : nullptr))
 	{
-		ConsumeWhitespace(inputStream, position, output);
-		return true;
+		return false;
 	}
-	else if (nextCodePoint == CodePointValue::QUOTATION_MARK)
+	const SizeType tokenStart = inputStream.GetPosition();
+	const CodePoint nextCodePoint = inputStream.Peek();
+	if (IsEOF(nextCodePoint))
 	{
-		if (!ConsumeStringToken(inputStream, position, output, nextCodePoint))
-		{
-			return false;
-		}
+		output = Token::CreateEOF();
 		return true;
 	}
-	else if (nextCodePoint == CodePointValue::NUMBER_SIGN)
+	inputStream.Advance();
+	switch (GetTokenStart(nextCodePoint))
 	{
+	case TokenStart::Whitespace:
+		ConsumeWhitespace(inputStream, output);
+		return true;
+	case TokenStart::QuotationMark:
+	case TokenStart::Apostrophe:
+		return ConsumeStringToken(inputStream, tokens, output, nextCodePoint);
+	case TokenStart::NumberSign:
+	{
+		const CodePoint first = inputStream.Peek();
+		const CodePoint second = inputStream.Peek(1);
+		if (IsIdent(first) || AreTwoCodePointsValidEscape(first, second))
 		{
-			const CodePoint& nextCodePoint = inputStream[position];
-			if (IsIdent(nextCodePoint) || AreTwoCodePointsValidEscape(inputStream, position))
+			const bool isID = DoThreeCodePointsStartIndentSequence(first, second, inputStream.Peek(2));
+			TokenValueBuilder<InputStream> ident(inputStream, tokens);
+			if (!ConsumeIdentSequence(inputStream, ident))
 			{
-				const bool isID = DoThreeCodePointsStartIndentSequence(inputStream, position);
-				Vector<CodePoint> ident;
-				if (!ConsumeIdentSequence(inputStream, position, ident))
-				{
-					return false;
-				}
-				new (output.data()) Token(Token::CreateHash(HashTokenValue(std::move(ident), isID)));
-				return true;
+				return false;
 			}
+			output = Token::CreateHash(ident.GetValue(), isID);
+			return true;
 		}
-		new (output.data()) Token(Token::CreateDelim(nextCodePoint));
+		output = Token::CreateDelim(nextCodePoint);
 		return true;
 	}
-	else if (nextCodePoint == CodePointValue::APOSTROPHE)
-	{
-		if (!ConsumeStringToken(inputStream, position, output, nextCodePoint))
+	case TokenStart::LeftParenthesis:
+		output = Token::CreateLeftParenthesis();
+		return true;
+	case TokenStart::RightParenthesis:
+		output = Token::CreateRightParenthesis();
+		return true;
+	case TokenStart::PlusSign:
+	case TokenStart::FullStop:
+		if (DoThreeCodePointsStartNumber(nextCodePoint, inputStream.Peek(), inputStream.Peek(1)))
 		{
-			return false;
+			inputStream.SetPosition(tokenStart);
+			return ConsumeNumericToken(inputStream, tokens, output);
 		}
+		output = Token::CreateDelim(nextCodePoint);
 		return true;
-	}
-	else if (nextCodePoint == CodePointValue::LEFT_PARENTHESIS)
-	{
-		new (output.data()) Token(Token::CreateLeftParenthesis());
-		return true;
-	}
-	else if (nextCodePoint == CodePointValue::RIGHT_PARENTHESIS)
-	{
-		new (output.data()) Token(Token::CreateRightParenthesis());
+	case TokenStart::Comma:
+		output = Token::CreateComma();
 		return true;
-	}
-	else if (nextCodePoint == CodePointValue::PLUS_SIGN)
+	case TokenStart::HyphenMinus:
 	{
-		if (DoThreeCodePointsStartNumber(inputStream, position - 1))
+		const CodePoint first = inputStream.Peek();
+		const CodePoint second = inputStream.Peek(1);
+		if (DoThreeCodePointsStartNumber(nextCodePoint, first, second))
 		{
-			--position;
-			if (!ConsumeNumericToken(inputStream, position, output))
-			{
-				return false;
-			}
+			inputStream.SetPosition(tokenStart);
+			return ConsumeNumericToken(inputStream, tokens, output);
+		}
+		else if (first == CodePointValue::HYPHEN_MINUS && second == CodePointValue::GREATER_THAN_SIGN)
+		{
+			inputStream.Advance(2);
+			output = Token::CreateCDC();
 			return true;
 		}
-		new (output.data()) Token(Token::CreateDelim(nextCodePoint));
+		else if (DoThreeCodePointsStartIndentSequence(nextCodePoint, first, second))
+		{
+			inputStream.SetPosition(tokenStart);
+			return ConsumeIdentLikeToken(inputStream, tokens, output);
+		}
+		output = Token::CreateDelim(nextCodePoint);
 		return true;
 	}
-	else if (nextCodePoint == CodePointValue::COMMA)
-	{
-		new (output.data()) Token(Token::CreateComma());
+	case TokenStart::Colon:
+		output = Token::CreateColon();
 		return true;
-	}
-	else if (nextCodePoint == CodePointValue::HYPHEN_MINUS)
-	{
-		if (DoThreeCodePointsStartNumber(inputStream, position - 1))
-		{
-			--position;
-			if (!ConsumeNumericToken(inputStream, position, output))
-			{
-				return false;
-			}
-			return true;
-		}
-		else if (position + 1 < inputStream.size() &&
-			inputStream[position] == CodePointValue::HYPHEN_MINUS &&
-			inputStream[position + 1] == CodePointValue::GREATER_THAN_SIGN)
+	case TokenStart::SemiColon:
+		output = Token::CreateSemiColon();
+		return true;
+	case TokenStart::LessThanSign:
+		if (inputStream.Peek() == CodePointValue::EXCLAMATION_MARK &&
+			inputStream.Peek(1) == CodePointValue::HYPHEN_MINUS &&
+			inputStream.Peek(2) == CodePointValue::HYPHEN_MINUS)
 		{
-			position += 2;
-			new (output.data()) Token(Token::CreateCDC());
+			inputStream.Advance(3);
+			output = Token::CreateCDO();
 			return true;
 		}
-		else if (DoThreeCodePointsStartIndentSequence(inputStream, position - 1))
+		output = Token::CreateDelim(nextCodePoint);
+		return true;
+	case TokenStart::CommercialAt:
+		if (DoThreeCodePointsStartIndentSequence(inputStream.Peek(), inputStream.Peek(1), inputStream.Peek(2)))
 		{
-			--position;
-			if (!ConsumeIdentLikeToken(inputStream, position, output))
+			TokenValueBuilder<InputStream> ident(inputStream, tokens);
+			if (!ConsumeIdentSequence(inputStream, ident))
 			{
 				return false;
 			}
+			output = Token::CreateAtKeyword(ident.GetValue());
 			return true;
 		}
-		new (output.data()) Token(Token::CreateDelim(nextCodePoint));
+		output = Token::CreateDelim(nextCodePoint);
 		return true;
-	}
-	else if (nextCodePoint == CodePointValue::FULL_STOP)
-	{
-		if (DoThreeCodePointsStartNumber(inputStream, position - 1))
+	case TokenStart::LeftSquareBracket:
+		output = Token::CreateLeftSquareBracket();
+		return true;
+	case TokenStart::ReverseSolidus:
+		if (AreTwoCodePointsValidEscape(nextCodePoint, inputStream.Peek()))
 		{
-			--position;
-			if (!ConsumeNumericToken(inputStream, position, output))
-			{
-				return false;
-			}
-			return true;
+			inputStream.SetPosition(tokenStart);
+			return ConsumeIdentLikeToken(inputStream, tokens, output);
 		}
-		new (output.data()) Token(Token::CreateDelim(nextCodePoint));
+		output = Token::CreateDelim(nextCodePoint);
+		return true;
+	case TokenStart::RightSquareBracket:
+		output = Token::CreateRightSquareBracket();
+		return true;
+	case TokenStart::LeftCurlyBracket:
+		output = Token::CreateLeftCurlyBracket();
+		return true;
+	case TokenStart::RightCurlyBracket:
+		output = Token::CreateRightCurlyBracket();
 		return true;
+	case TokenStart::Digit:
+		inputStream.SetPosition(tokenStart);
+		return ConsumeNumericToken(inputStream, tokens, output);
+	case TokenStart::IdentStart:
+		inputStream.SetPosition(tokenStart);
+		return ConsumeIdentLikeToken(inputStream, tokens, output);
+	case TokenStart::Delim:
+		break;
+	}
+	output = Token::CreateDelim(nextCodePoint);
+	return true;
+}
+
+// Stylesheets average three to five code points per token, whitespace tokens included, so the tokens of most inputs
+// fit without being moved, and those of the others after a single reallocation instead of one per doubling.
+// The results that are kept give back what is left over with TokenList::ShrinkToFit.
+SizeType EstimateTokenCount(SizeType inputSize)
+{
+	return inputSize / 3 + 1;
+}
+
+TokenType GetClosingType(TokenType type)
+{
+	switch (type)
+	{
+	case TokenType::Function:
+	case TokenType::LeftParenthesis:
+		return TokenType::RightParenthesis;
+	case TokenType::LeftSquareBracket:
+		return TokenType::RightSquareBracket;
+	case TokenType::LeftCurlyBracket:
+		return TokenType::RightCurlyBracket;
+	default:
+		return TokenType::EndOfFile;
 	}
-	else if (nextCodePoint == CodePointValue::COLON)
+}
+
+// Like in https://www.w3.org/TR/css-syntax-3/#consume-a-simple-block and https://www.w3.org/TR/css-syntax-3/#consume-function
+// only the ending token of the innermost block closes it, any other closing token is part of its contents.
+// The open blocks are chained from the innermost one through their partner indices, so there is no stack to allocate.
+void PairToken(Vector<Token>& tokens, unsigned index, unsigned& innermostOpen)
+{
+	Token& token = tokens[index];
+	if (GetClosingType(token.GetType()) != TokenType::EndOfFile)
 	{
-		new (output.data()) Token(Token::CreateColon());
-		return true;
+		token.SetPartnerIndex(innermostOpen);
+		innermostOpen = index;
 	}
-	else if (nextCodePoint == CodePointValue::SEMI_COLON)
+	else if (innermostOpen != Token::NO_PARTNER && token.GetType() == GetClosingType(tokens[innermostOpen].GetType()))
 	{
-		new (output.data()) Token(Token::CreateSemiColon());
-		return true;
+		Token& open = tokens[innermostOpen];
+		const unsigned outer = open.GetPartnerIndex();
+		open.SetPartnerIndex(index);
+		token.SetPartnerIndex(innermostOpen);
+		innermostOpen = outer;
+	}
+}
+
+void LeaveUnclosed(Vector<Token>& tokens, unsigned innermostOpen)
+{
+	while (innermostOpen != Token::NO_PARTNER)
+	{
+		Token& open = tokens[innermostOpen];
+		innermostOpen = open.GetPartnerIndex();
+		open.SetPartnerIndex(Token::NO_PARTNER);
+	}
+}
+
+// inputSize is the number of code points in inputStream, or an upper bound of it.
+// The bracket and function tokens are paired as they are pushed, see Token::GetPartnerIndex.
+template <typename InputStream>
+bool Tokenize(InputStream& inputStream, SizeType inputSize, TokenList& output, const TokenizerOptions& options)
+{
+	if (inputSize > MAX_INPUT_SIZE)
+	{
+		return false;
 	}
-	else if (nextCodePoint == CodePointValue::LESS_THAN_SIGN)
+	output.m_Tokens.reserve(output.m_Tokens.size() + EstimateTokenCount(inputSize));
+	unsigned innermostOpen = Token::NO_PARTNER;
+	for (;;)
 	{
-		if (position + 2 < inputStream.size() &&
-			inputStream[position] == CodePointValue::EXCLAMATION_MARK &&
-			inputStream[position + 1] == CodePointValue::HYPHEN_MINUS &&
-			inputStream[position + 2] == CodePointValue::HYPHEN_MINUS)
+		Token token;
+		if (!ConsumeToken(inputStream, output, token, options))
+		{
+			LeaveUnclosed(output.m_Tokens, innermostOpen);
+			return false;
+		}
+		if (token.GetType() == TokenType::EndOfFile)
 		{
-			position += 3;
-			new (output.data()) Token(Token::CreateCDO());
+			LeaveUnclosed(output.m_Tokens, innermostOpen);
 			return true;
 		}
-		new (output.data()) Token(Token::CreateDelim(nextCodePoint));
-		return true;
+		output.m_Tokens.push_back(token);
+		PairToken(output.m_Tokens, static_cast<unsigned>(output.m_Tokens.size() - 1), innermostOpen);
+	}
+}
+
+bool TokenizeCodePoints(const Vector<CodePoint>& inputStream, TokenList& output, const TokenizerOptions& options)
+{
+	CodePointInputStream<CodePoint> codePointStream(inputStream);
+	return Tokenize(codePointStream, inputStream.size() - END_OF_FILE_PADDING, output, options);
+}
+
+bool TokenizeCodePoints(const CodePointBuffer& inputStream, TokenList& output, const TokenizerOptions& options)
+{
+	switch (inputStream.GetCodeUnitSize())
+	{
+	case 1:
+	{
+		CodePointInputStream<unsigned char> latin1Stream(inputStream.GetLatin1());
+		return Tokenize(latin1Stream, inputStream.GetLatin1().size() - END_OF_FILE_PADDING, output, options);
+	}
+	case 2:
+	{
+		CodePointInputStream<char16_t> UCS2Stream(inputStream.GetUCS2());
+		return Tokenize(UCS2Stream, inputStream.GetUCS2().size() - END_OF_FILE_PADDING, output, options);
+	}
+	default:
+		return TokenizeCodePoints(inputStream.GetUTF32(), output, options);
 	}
-	else if (nextCodePoint == CodePointValue::COMMERCIAL_AT)
+}
+
+bool TokenizeUTF8(const char* text, SizeType size, TokenList& output, const TokenizerOptions& options)
+{
+	UTF8InputStream utf8Stream(text, size);
+	output.m_Input = utf8Stream.GetInput();
+	return Tokenize(utf8Stream, output.m_Input.size(), output, options);
+}
+
+Tokenizer::Tokenizer(const char* text, SizeType size, const TokenizerOptions& options, MemoryResource* resource)
+	: m_InputStream(text, size)
+	, m_Values(resource)
+	, m_Options(options)
+	, m_IsInputTooLarge(size > MAX_INPUT_SIZE)
+{
+	m_Values.m_Input = m_InputStream.GetInput();
+}
+
+bool Tokenizer::Next(Token& output)
+{
+	if (m_IsInputTooLarge)
 	{
-		if (DoThreeCodePointsStartIndentSequence(inputStream, position - 1))
+		return false;
+	}
+	return ConsumeToken(m_InputStream, m_Values, output, m_Options);
+}
+
+void Tokenizer::Reset(const char* text, SizeType size)
+{
+	m_InputStream = UTF8InputStream(text, size);
+	m_IsInputTooLarge = size > MAX_INPUT_SIZE;
+	m_Values.Clear();
+	m_Values.m_Input = m_InputStream.GetInput();
+}
+
+const TokenList& Tokenizer::GetValues() const
+{
+	return m_Values;
+}
+
+StreamingTokenizer::StreamingTokenizer(MemoryResource* resource)
+	: m_Encoding(Encoding::UTF8)
+	, m_UTF16Decoder(false)
+	, m_Pending(resource)
+	, m_ReadPosition(0)
+	, m_BOMPrefix(resource)
+	, m_IsBOMChecked(false)
+{
+}
+
+bool StreamingTokenizer::Feed(const char* chunk, SizeType size, TokenList& output)
+{
+	if (!m_IsBOMChecked)
+	{
+		m_BOMPrefix.append(chunk, size);
+		if (m_BOMPrefix.size() < 3)
 		{
-			--position;
-			Vector<CodePoint> ident;
-			if (!ConsumeIdentSequence(inputStream, position, ident))
-			{
-				return false;
-			}
-			new (output.data()) Token(Token::CreateAtKeyword(std::move(ident)));
 			return true;
 		}
-		new (output.data()) Token(Token::CreateDelim(nextCodePoint));
-		return true;
+		DecodeBOMPrefix();
 	}
-	else if (nextCodePoint == CodePointValue::LEFT_SQUARE_BRACKET)
+	else
 	{
-		new (output.data()) Token(Token::CreateLeftSquareBracket());
-		return true;
+		Decode(StringView(chunk, size));
 	}
-	else if (nextCodePoint == CodePointValue::LEFT_CURLY_BRACKET)
+	return TokenizePending(false, output);
+}
+
+bool StreamingTokenizer::Finish(TokenList& output)
+{
+	if (!m_IsBOMChecked)
 	{
-		new (output.data()) Token(Token::CreateLeftCurlyBracket());
-		return true;
+		DecodeBOMPrefix();
+	}
+	if (m_Encoding == Encoding::UTF8)
+	{
+		m_UTF8Decoder.Finish(m_Pending);
+	}
+	else
+	{
+		m_UTF16Decoder.Finish(m_Pending);
+	}
+	const bool result = TokenizePending(true, output);
+	// The next chunk starts a new input, with its own BOM.
+	m_Encoding = Encoding::UTF8;
+	m_UTF8Decoder = UTF8Decoder();
+	m_UTF16Decoder = UTF16Decoder(false);
+	m_Pending.clear();
+	m_ReadPosition = 0;
+	m_Scan.Stop();
+	m_IsBOMChecked = false;
+	return result;
+}
+
+void StreamingTokenizer::DecodeBOMPrefix()
+{
+	m_IsBOMChecked = true;
+	StringView input(m_BOMPrefix);
+	const Encoding BOMEncoding = BOMSniff(input, 0);
+	if (BOMEncoding != Encoding::Count)
+	{
+		m_Encoding = BOMEncoding;
+		m_UTF16Decoder = UTF16Decoder(BOMEncoding == Encoding::UTF16BE);
+		input.remove_prefix(BOMEncoding == Encoding::UTF8 ? 3 : 2);
+	}
+	Decode(input);
+	m_BOMPrefix.clear();
+	m_BOMPrefix.shrink_to_fit();
+}
+
+void StreamingTokenizer::Decode(const StringView& chunk)
+{
+	if (m_Encoding == Encoding::UTF8)
+	{
+		m_UTF8Decoder.Decode(chunk, m_Pending);
+	}
+	else
+	{
+		m_UTF16Decoder.Decode(chunk, m_Pending);
+	}
+}
+
+bool StreamingTokenizer::TokenizePending(bool isLastChunk, TokenList& output)
+{
+	if (output.m_Payload.size() / 4 + (m_Pending.size() - m_ReadPosition) > MAX_INPUT_SIZE)
+	{
+		return false;
 	}
-	else if (nextCodePoint == CodePointValue::RIGHT_CURLY_BRACKET)
+	if (!isLastChunk && m_Scan.IsActive() && !m_Scan.Resume(m_Pending))
 	{
-		new (output.data()) Token(Token::CreateRightCurlyBracket());
 		return true;
 	}
-	else if (IsDigit(nextCodePoint))
+	PadWithEndOfFile(m_Pending);
+	CodePointInputStream<CodePoint> inputStream(m_Pending);
+	inputStream.SetPosition(m_ReadPosition);
+	SizeType consumed = m_ReadPosition;
+	bool isTokenPending = false;
+	bool result = true;
+	for (;;)
 	{
-		--position;
-		if (!ConsumeNumericToken(inputStream, position, output))
+		const bool areCommentsConsumed = ConsumeComments(inputStream, nullptr);
+		if (!isLastChunk && inputStream.MayHavePeekedPastEnd())
 		{
-			return false;
+			// An unterminated comment, or a U+002F SOLIDUS (/) that may start one.
+			isTokenPending = true;
+			break;
 		}
-		return true;
+		if (!areCommentsConsumed)
+		{
+			result = false;
+			break;
+		}
+		consumed = inputStream.GetPosition();
+		const SizeType numbersSize = output.m_Numbers.size();
+		const SizeType payloadSize = output.m_Payload.size();
+		Token token;
+		const bool isTokenConsumed = ConsumeToken(inputStream, output, token, TokenizerOptions());
+		if (!isLastChunk && inputStream.MayHavePeekedPastEnd())
+		{
+			// The token may continue in the next chunk, it is consumed again once its end has arrived.
+			output.m_Numbers.erase(output.m_Numbers.begin() + numbersSize, output.m_Numbers.end());
+			output.m_Payload.resize(payloadSize);
+			isTokenPending = true;
+			break;
+		}
+		if (!isTokenConsumed)
+		{
+			result = false;
+			break;
+		}
+		if (token.GetType() == TokenType::EndOfFile)
+		{
+			consumed = inputStream.GetPosition();
+			break;
+		}
+		output.m_Tokens.push_back(token);
+		consumed = inputStream.GetPosition();
+	}
+	m_Pending.erase(m_Pending.end() - END_OF_FILE_PADDING, m_Pending.end());
+	if (!isTokenPending)
+	{
+		m_Scan.Stop();
+	}
+	else if (consumed == m_ReadPosition && m_Scan.IsActive())
+	{
+		m_Scan.Continue(m_Pending);
+		m_Scan.Resume(m_Pending);
+	}
+	else
+	{
+		m_Scan.Start(m_Pending, consumed);
+		m_Scan.Resume(m_Pending);
+	}
+	m_ReadPosition = consumed;
+	DropConsumed();
+	return result;
+}
+
+void StreamingTokenizer::DropConsumed()
+{
+	// Dropping code points moves the ones after them, which is only done once it moves fewer than were dropped.
+	if (m_ReadPosition * 2 < m_Pending.size())
+	{
+		return;
+	}
+	m_Pending.erase(m_Pending.begin(), m_Pending.begin() + m_ReadPosition);
+	m_Scan.Shift(m_ReadPosition);
+	m_ReadPosition = 0;
+}
+
+// Whether the digits of a number go on with a fraction or an exponent at position, which has two code points after it.
+bool IsFractionOrExponent(const Vector<CodePoint>& codePoints, SizeType position)
+{
+	const CodePoint first = codePoints[position];
+	const CodePoint second = codePoints[position + 1];
+	if (first == CodePointValue::FULL_STOP)
+	{
+		return IsDigit(second);
 	}
-	else if (IsIdentStart(nextCodePoint))
+	if (first != CodePointValue::LATIN_CAPITAL_LETTER_E && first != CodePointValue::LATIN_SMALL_LETTER_E)
 	{
-		--position;
-		if (!ConsumeIdentLikeToken(inputStream, position, output))
+		return false;
+	}
+	return IsDigit(second)
+		|| ((second == CodePointValue::PLUS_SIGN || second == CodePointValue::HYPHEN_MINUS) && IsDigit(codePoints[position + 2]));
+}
+
+void StreamingTokenizer::PendingTokenScan::Start(const Vector<CodePoint>& pending, SizeType position)
+{
+	*this = PendingTokenScan();
+	if (position >= pending.size())
+	{
+		return;
+	}
+	// The code points that have not arrived yet are taken as EOF, which at worst finds an end too early.
+	const auto peek = [&pending, position](SizeType offset)
+	{
+		return position + offset < pending.size() ? pending[position + offset] : CodePoint(CodePointValue::END_OF_FILE);
+	};
+	const CodePoint first = peek(0);
+	const CodePoint second = peek(1);
+	m_Position = position + 1;
+	if (first == CodePointValue::SOLIDUS && second == CodePointValue::ASTERISK)
+	{
+		m_Kind = Kind::Comment;
+		++m_Position;
+	}
+	else if (IsQuotationMarkOrApostrophe(first))
+	{
+		m_Kind = Kind::String;
+		m_Quote = first;
+	}
+	else if (IsWhitespace(first))
+	{
+		m_Kind = Kind::Whitespace;
+	}
+	else if (IsDigit(first)
+		|| ((first == CodePointValue::PLUS_SIGN || first == CodePointValue::HYPHEN_MINUS || first == CodePointValue::FULL_STOP)
+			&& IsDigit(second)))
+	{
+		// The digits of a number, what comes after them is scanned once they are known not to be all of it.
+		m_Kind = Kind::Number;
+	}
+	else if (DoThreeCodePointsStartIndentSequence(first, second, peek(2)))
+	{
+		m_Kind = Kind::IdentLike;
+		if (first == CodePointValue::REVERSE_SOLIDUS)
 		{
-			return false;
+			m_Escape = Escape::AfterReverseSolidus;
 		}
-		return true;
+	}
+	else if ((first == CodePointValue::NUMBER_SIGN && (IsIdent(second) || AreTwoCodePointsValidEscape(second, peek(2))))
+		|| (first == CodePointValue::COMMERCIAL_AT && DoThreeCodePointsStartIndentSequence(second, peek(2), peek(3))))
+	{
+		// A hash or an at-keyword.
+		m_Kind = Kind::Ident;
 	}
 	else
 	{
-		new (output.data()) Token(Token::CreateDelim(nextCodePoint));
-		return true;
+		m_Kind = Kind::Other;
+		m_End = m_Position;
 	}
-	return true;
 }
 
-bool TokenizeCodePoints(const Vector<CodePoint>& inputStream, Vector<Token>& output)
+void StreamingTokenizer::PendingTokenScan::Continue(const Vector<CodePoint>& pending)
 {
-	// https://www.w3.org/TR/css-syntax-3/#consume-token
-	Vector<Token> outputLocal;
-	SizeType position = 0;
-	while (position < inputStream.size())
+	// The token was not consumed with the code points up to a few after the end found, so the code point at
+	// that end is part of it.
+	CSS_PARSER_ASSERT(m_End != NO_END, "Continuing a token before its end was found");
+	const SizeType end = m_End;
+	if (m_Kind == Kind::String)
+	{
+		m_Escape = Escape::None;
+		m_Position = end;
+		m_End = NO_END;
+	}
+	else if (m_Kind == Kind::IdentLike && pending[end - 1] == CodePointValue::LEFT_PARENTHESIS)
 	{
-		FixedArray<Byte, sizeof(Token)> token;
-		if (!ConsumeToken(inputStream, position, token))
+		// https://www.w3.org/TR/css-syntax-3/#consume-ident-like-token
+		// Only url( goes on after the U+0028 LEFT PARENTHESIS ((), with a function or a url token.
+		*this = PendingTokenScan();
+		m_Kind = Kind::URL;
+		m_IsInLeadingWhitespace = true;
+		m_Position = end;
+	}
+	else if (m_Kind == Kind::Number && IsFractionOrExponent(pending, end))
+	{
+		// https://www.w3.org/TR/css-syntax-3/#consume-number
+		*this = PendingTokenScan();
+		m_Kind = Kind::Number;
+		m_Position = IsDigit(pending[end + 1]) ? end + 1 : end + 2;
+	}
+	else if (m_Kind == Kind::Other)
+	{
+		// More code points have arrived to tell what token it is, e.g. for a U+0040 COMMERCIAL AT (@).
+		Start(pending, end - 1);
+	}
+	else
+	{
+		// E.g. the unit of a dimension, or a comment right after another one.
+		const bool isUnit = m_Kind == Kind::Number;
+		Start(pending, end);
+		if (isUnit && m_Kind == Kind::IdentLike)
 		{
-			return false;
+			m_Kind = Kind::Ident;
 		}
-		output.push_back(std::move(*reinterpret_cast<Token*>(token.data())));
 	}
-	return true;
+}
 
+bool StreamingTokenizer::PendingTokenScan::Resume(const Vector<CodePoint>& pending)
+{
+	const SizeType size = pending.size();
+	for (; m_End == NO_END && m_Position < size; ++m_Position)
+	{
+		const CodePoint codePoint = pending[m_Position];
+		if (m_Escape != Escape::None)
+		{
+			if ((m_Kind == Kind::Ident || m_Kind == Kind::IdentLike) && m_Escape == Escape::AfterReverseSolidus
+				&& IsNewline(codePoint))
+			{
+				// Not a valid escape, the ident ends at the U+005C REVERSE SOLIDUS (\).
+				m_End = m_Position - 1;
+				continue;
+			}
+			if (ScanEscape(codePoint))
+			{
+				continue;
+			}
+		}
+		switch (m_Kind)
+		{
+		case Kind::Comment:
+			if (m_IsAfterAsterisk && codePoint == CodePointValue::SOLIDUS)
+			{
+				m_End = m_Position + 1;
+			}
+			m_IsAfterAsterisk = codePoint == CodePointValue::ASTERISK;
+			break;
+		case Kind::String:
+			if (codePoint == m_Quote)
+			{
+				m_End = m_Position + 1;
+			}
+			else if (IsNewline(codePoint))
+			{
+				m_End = m_Position;
+			}
+			else if (codePoint == CodePointValue::REVERSE_SOLIDUS)
+			{
+				m_Escape = Escape::AfterReverseSolidus;
+			}
+			break;
+		case Kind::Whitespace:
+			if (!IsWhitespace(codePoint))
+			{
+				m_End = m_Position;
+			}
+			break;
+		case Kind::Number:
+			if (!IsDigit(codePoint))
+			{
+				m_End = m_Position;
+			}
+			break;
+		case Kind::Ident:
+		case Kind::IdentLike:
+			if (codePoint == CodePointValue::REVERSE_SOLIDUS)
+			{
+				m_Escape = Escape::AfterReverseSolidus;
+			}
+			else if (m_Kind == Kind::IdentLike && codePoint == CodePointValue::LEFT_PARENTHESIS)
+			{
+				m_End = m_Position + 1;
+			}
+			else if (!IsIdent(codePoint))
+			{
+				m_End = m_Position;
+			}
+			break;
+		case Kind::URL:
+			// https://www.w3.org/TR/css-syntax-3/#consume-url-token
+			// Whether it is a url token or a bad url token, it ends at a U+0029 RIGHT PARENTHESIS ()) that is not
+			// escaped. A quote after the leading whitespace makes it a function token instead.
+			if (m_IsInLeadingWhitespace)
+			{
+				if (IsWhitespace(codePoint))
+				{
+					break;
+				}
+				m_IsInLeadingWhitespace = false;
+				if (IsQuotationMarkOrApostrophe(codePoint))
+				{
+					// The function token keeps the last whitespace for a whitespace token.
+					m_End = IsWhitespace(pending[m_Position - 1]) ? m_Position - 1 : m_Position;
+					break;
+				}
+			}
+			if (codePoint == CodePointValue::RIGHT_PARENTHESIS)
+			{
+				m_End = m_Position + 1;
+			}
+			else if (codePoint == CodePointValue::REVERSE_SOLIDUS)
+			{
+				m_Escape = Escape::AfterReverseSolidus;
+			}
+			break;
+		default:
+			CSS_PARSER_ASSERT(false, "Scanning without a pending token");
+			break;
+		}
+	}
+	return m_End != NO_END && m_End + END_OF_FILE_PADDING <= size;
+}
+
+bool StreamingTokenizer::PendingTokenScan::ScanEscape(const CodePoint& codePoint)
+{
+	// https://www.w3.org/TR/css-syntax-3/#consume-escaped-code-point
+	// Returns whether the code point is part of the escape.
+	if (m_Escape == Escape::AfterReverseSolidus)
+	{
+		m_Escape = IsHexDigit(codePoint) ? Escape::HexDigits : Escape::None;
+		m_HexDigitCount = 1;
+		return true;
+	}
+	if (IsHexDigit(codePoint) && m_HexDigitCount < 6)
+	{
+		++m_HexDigitCount;
+		return true;
+	}
+	// A whitespace after the hex digits is part of the escape too.
+	m_Escape = Escape::None;
+	return IsWhitespace(codePoint);
+}
+
+void StreamingTokenizer::PendingTokenScan::Stop()
+{
+	*this = PendingTokenScan();
+}
+
+bool StreamingTokenizer::PendingTokenScan::IsActive() const
+{
+	return m_Kind != Kind::None;
+}
+
+void StreamingTokenizer::PendingTokenScan::Shift(SizeType offset)
+{
+	if (!IsActive())
+	{
+		return;
+	}
+	m_Position -= offset;
+	if (m_End != NO_END)
+	{
+		m_End -= offset;
+	}
 }
 }
\ No newline at end of file
@@ -26,10 +26,13 @@ SOFTWARE.
 
 #include "CommonTypes.h"
 #include "CodePoints.h"
+#include "InputStreams.h"
+
+#include <limits>
 
 namespace css_parser
 {
-enum class TokenType
+enum class TokenType : unsigned char
 {
 	Ident,
 	Function,
@@ -54,45 +57,54 @@ enum class TokenType
 	LeftParenthesis,
 	RightParenthesis,
 	LeftCurlyBracket,
-	RightCurlyBracket
-};
-
-class HashTokenValue
-{
-public:
-	// Additionally, hash tokens have a type flag set to either "id" or "unrestricted".
-	// The type flag defaults to "unrestricted" if not otherwise set.
-	HashTokenValue(Vector<CodePoint>&& value, bool isID = false);
-public:
-	Vector<CodePoint> m_Value;
-	bool m_IsID;
+	RightCurlyBracket,
+	EndOfFile
 };
 
+// <number-token>, <percentage-token> and <dimension-token> values.
 class NumberTokenValue
 {
 public:
-	constexpr static unsigned BYTES_FOR_VALUE = 64;
 	// <number-token> and <dimension-token> additionally have a type flag set to either "integer" or "number".
-	// The type flag defaults to "integer" if not otherwise set. 
-	NumberTokenValue(FixedArray<Byte, BYTES_FOR_VALUE>&& value, bool isInteger = true);
+	// The type flag defaults to "integer" if not otherwise set.
+	explicit NumberTokenValue(int64_t value);
+	explicit NumberTokenValue(double value);
+	bool IsInteger() const;
+	int64_t GetInteger() const;
+	// The value as a double, whatever the type flag.
+	double GetNumber() const;
 private:
-	FixedArray<Byte, BYTES_FOR_VALUE> m_Value;
-	bool m_IsInteger = true;
+	union
+	{
+		int64_t m_Integer;
+		double m_Number;
+	};
+	bool m_IsInteger;
 };
 
-class DimensionTokenValue
+// Where the value of a token is: a range of UTF-8 bytes either in the tokenized input,
+// or in the payload of the TokenList when the value is not in the input as-is.
+struct TokenValue
 {
-public:
-	DimensionTokenValue(NumberTokenValue&& number, Vector<CodePoint>&& unit);
-private:
-	NumberTokenValue m_Number;
-	// <dimension-token> additionally have a unit composed of one or more code points.
-	Vector<CodePoint> m_Unit;
+	unsigned m_Offset = 0;
+	unsigned m_Length = 0;
+	bool m_IsInPayload = false;
 };
 
+// The offsets and lengths of values are 32-bit, which keeps tokens at 16 bytes. A code unit of input adds at most
+// four bytes to the payload, e.g. an invalid UTF-8 byte becomes a U+FFFD REPLACEMENT CHARACTER, so inputs of more
+// code units than this are rejected, instead of giving values that refer to the wrong bytes.
+constexpr SizeType MAX_INPUT_SIZE = std::numeric_limits<unsigned>::max() / 4;
+
+// Tokens are 16 bytes and do not own their values, see TokenList.
 class Token
 {
 public:
+	constexpr static unsigned NO_PARTNER = ~0u;
+
+	// An <EOF-token>.
+	Token();
+
 	static Token CreateWhitespace();
 	static Token CreateBadString();
 	static Token CreateBadURL();
@@ -108,24 +120,225 @@ public:
 	static Token CreateCDC();
 	static Token CreateCDO();
 	static Token CreateDelim(const CodePoint& value);
-	static Token CreateHash(HashTokenValue&& value);
-	static Token CreateString(Vector<CodePoint>&& value);
-	static Token CreateNumber(NumberTokenValue&& value);
-	static Token CreatePercentage(NumberTokenValue&& value);
-	static Token CreateDimension(DimensionTokenValue&& value);
-	static Token CreateFunction(Vector<CodePoint>&& value);
-	static Token CreateIdent(Vector<CodePoint>&& value);
-	static Token CreateURL(Vector<CodePoint>&& value);
-	static Token CreateAtKeyword(Vector<CodePoint>&& value);
+	// Additionally, hash tokens have a type flag set to either "id" or "unrestricted".
+	// The type flag defaults to "unrestricted" if not otherwise set.
+	static Token CreateHash(const TokenValue& value, bool isID = false);
+	static Token CreateString(const TokenValue& value);
+	static Token CreateNumber(unsigned numberIndex);
+	static Token CreatePercentage(unsigned numberIndex);
+	// <dimension-token> additionally have a unit composed of one or more code points.
+	static Token CreateDimension(unsigned numberIndex, const TokenValue& unit);
+	static Token CreateFunction(const TokenValue& value);
+	static Token CreateIdent(const TokenValue& value);
+	static Token CreateURL(const TokenValue& value);
+	static Token CreateAtKeyword(const TokenValue& value);
+	static Token CreateEOF();
+
+	TokenType GetType() const;
+	bool IsID() const;
+	CodePoint GetDelim() const;
+	// The value of an ident, function, at-keyword, hash, string or url token, or the unit of a dimension token.
+	TokenValue GetValue() const;
+	// Index in TokenList::m_Numbers of the value of a number, percentage or dimension token.
+	unsigned GetNumberIndex() const;
+	// For a (, [, { or function token, the index in TokenList::m_Tokens of the token that closes its block,
+	// and for a ), ] or } token, the index of the token it closes. NO_PARTNER for blocks that are not closed
+	// before EOF, closing tokens that close nothing, and tokens that were not tokenized into a list.
+	unsigned GetPartnerIndex() const;
+	void SetPartnerIndex(unsigned index);
 private:
+	constexpr static unsigned char FLAG_IS_ID = 1 << 0;
+	constexpr static unsigned char FLAG_IS_VALUE_IN_PAYLOAD = 1 << 1;
+
 	Token(TokenType type);
+	Token(TokenType type, const TokenValue& value);
 
 	TokenType m_Type;
-	Variant<Vector<CodePoint>, HashTokenValue, CodePoint, NumberTokenValue, DimensionTokenValue> m_Value;
+	unsigned char m_Flags;
+	unsigned m_Offset;
+	unsigned m_Length;
+	// The delim code point, the index of the numeric value, or the partner index.
+	unsigned m_Index;
+};
+static_assert(sizeof(Token) == 16, "Tokens are expected to stay 16 bytes");
+
+// The token that ends the block or function that type starts, or EndOfFile if it does not start one.
+TokenType GetClosingType(TokenType type);
+// Pairs tokens[index], which comes right after the tokens paired before it, with the innermost open block when it
+// closes it, see Token::GetPartnerIndex. innermostOpen is Token::NO_PARTNER before the first token.
+void PairToken(Vector<Token>& tokens, unsigned index, unsigned& innermostOpen);
+// Unlinks the blocks still open at the end of the tokens.
+void LeaveUnclosed(Vector<Token>& tokens, unsigned innermostOpen);
+
+// A comment, from its opening U+002F SOLIDUS (/) to past its closing one, as positions in the input:
+// byte offsets for UTF-8 input, code point indices for code point input.
+struct CommentRange
+{
+	SizeType m_Start = 0;
+	SizeType m_End = 0;
+};
+
+// The tokens of an input, together with the storage for their values.
+// Values are referenced in the input whenever they appear there unchanged, which for UTF-8 input is all of
+// them but those with escapes or invalid byte sequences. The others are decoded into m_Payload, which all the
+// tokens share, so no token owns an allocation.
+class TokenList
+{
+public:
+	explicit TokenList(MemoryResource* resource = std::pmr::get_default_resource());
+	// The UTF-8 text of the value.
+	StringView GetValue(const TokenValue& value) const;
+	StringView GetValue(const Token& token) const;
+	const NumberTokenValue& GetNumber(const Token& token) const;
+	void Clear();
+	// Releases the memory reserved past the tokens and their values, for lists that are kept once complete.
+	void ShrinkToFit();
+
+	Vector<Token> m_Tokens;
+	Vector<NumberTokenValue> m_Numbers;
+	String m_Payload;
+	// The tokenized input when it is UTF-8, the tokens refer to it and it has to outlive them.
+	StringView m_Input;
+	// Filled only when TokenizerOptions::m_IsReportingComments is set.
+	Vector<CommentRange> m_Comments;
+};
+
+struct TokenizerOptions
+{
+	// Comments are not tokens, by default they are dropped. When this is set their ranges are reported in
+	// TokenList::m_Comments, e.g. for tools that preserve the source.
+	bool m_IsReportingComments = false;
 };
 
 // To tokenize a stream of code points into a stream of CSS tokens input,
 // repeatedly consume a token from input until an <EOF-token> is reached,
 // pushing each of the returned tokens into a stream.
-bool TokenizeCodePoints(const Vector<CodePoint>& inputStream, Vector<Token>& output);
+// inputStream has to be followed by END_OF_FILE_PADDING EOF code points, like CreateCodePointsStream leaves it.
+// Returns false on a parse error, or when there are more than MAX_INPUT_SIZE code points.
+bool TokenizeCodePoints(const Vector<CodePoint>& inputStream, TokenList& output, const TokenizerOptions& options = TokenizerOptions());
+// The same for code points stored with the narrowest code units, the tokenizer is specialized for each size.
+bool TokenizeCodePoints(const CodePointBuffer& inputStream, TokenList& output, const TokenizerOptions& options = TokenizerOptions());
+// Push-style tokenizer for input that arrives in chunks, e.g. from a file or a socket.
+// Tokens are returned as soon as they are complete. Code points, comments, strings, escapes and
+// any other token can be split between chunks: the decoder state is carried over, and a token
+// whose consumption looked past the received input is consumed again when the next chunk arrives.
+// Only the code points of the token in progress are kept between calls. Comments are always dropped.
+// The encoding is UTF-8 unless the input starts with a UTF-16 BOM.
+class StreamingTokenizer
+{
+public:
+	explicit StreamingTokenizer(MemoryResource* resource = std::pmr::get_default_resource());
+	// Appends to output the tokens completed by chunk. Their values are always in the payload of output,
+	// which can be cleared between calls once the tokens have been processed.
+	// Returns false on a parse error, or when the payload and the token in progress could outgrow the offsets of
+	// values, see MAX_INPUT_SIZE, after which the tokenizer should not be fed anymore.
+	bool Feed(const char* chunk, SizeType size, TokenList& output);
+	// Ends the input and appends the remaining tokens to output. The tokenizer then starts over, like a new one,
+	// so the next chunk fed is the start of another input.
+	bool Finish(TokenList& output);
+private:
+	void DecodeBOMPrefix();
+	void Decode(const StringView& chunk);
+	bool TokenizePending(bool isLastChunk, TokenList& output);
+	void DropConsumed();
+
+	// Scans the code points of a token that did not fit in the pending ones for where it can end, resuming
+	// where the previous chunk stopped. The token is only consumed again once its end has arrived, so a long
+	// string, comment, url or ident that spans many chunks is not consumed from its start on every chunk.
+	// The end found can come before the actual end of the token, e.g. at the U+002E FULL STOP (.) of a
+	// number, but never after it.
+	class PendingTokenScan
+	{
+	public:
+		// Starts over with the token that begins at position.
+		void Start(const Vector<CodePoint>& pending, SizeType position);
+		// Continues past the end found, which was not the end of the token.
+		void Continue(const Vector<CodePoint>& pending);
+		// Scans the code points that arrived since the last call. Returns whether the token can be consumed,
+		// i.e. whether its end and the code points looked ahead at after it are pending.
+		bool Resume(const Vector<CodePoint>& pending);
+		void Stop();
+		bool IsActive() const;
+		// The pending code points before offset have been dropped.
+		void Shift(SizeType offset);
+	private:
+		enum class Kind : unsigned char
+		{
+			None,
+			Comment,
+			String,
+			Whitespace,
+			// An ident sequence, e.g. the name of a hash or the unit of a dimension.
+			Ident,
+			// An ident sequence that goes on with a U+0028 LEFT PARENTHESIS ((), if any.
+			IdentLike,
+			Number,
+			URL,
+			// Any other token, only known to go on past its first code point.
+			Other,
+		};
+		enum class Escape : unsigned char
+		{
+			None,
+			AfterReverseSolidus,
+			HexDigits,
+		};
+
+		bool ScanEscape(const CodePoint& codePoint);
+
+		static constexpr SizeType NO_END = ~SizeType(0);
+
+		Kind m_Kind = Kind::None;
+		Escape m_Escape = Escape::None;
+		unsigned char m_HexDigitCount = 0;
+		// The previous code point of a comment was U+002A ASTERISK (*), or a url is still in its leading whitespace.
+		bool m_IsAfterAsterisk = false;
+		bool m_IsInLeadingWhitespace = false;
+		CodePoint m_Quote = CodePoint(CodePointValue::END_OF_FILE);
+		// How far the code points have been scanned, and the position right after the end that was found.
+		SizeType m_Position = 0;
+		SizeType m_End = NO_END;
+	};
+
+	Encoding m_Encoding;
+	UTF8Decoder m_UTF8Decoder;
+	UTF16Decoder m_UTF16Decoder;
+	// Decoded code points that are not part of a complete token yet, from m_ReadPosition on.
+	// The ones before it are only dropped once they are at least half of them.
+	Vector<CodePoint> m_Pending;
+	SizeType m_ReadPosition;
+	PendingTokenScan m_Scan;
+	// The first bytes of the input are held back until it is known whether they are a BOM.
+	String m_BOMPrefix;
+	bool m_IsBOMChecked;
+};
+
+// Tokenizes UTF-8 encoded bytes without decoding them into a separate stream of code points first.
+// The input preprocessing is done while tokenizing, and a leading UTF-8 BOM is removed like the decoders remove it.
+// Returns false on a parse error, or when size is over MAX_INPUT_SIZE.
+bool TokenizeUTF8(const char* text, SizeType size, TokenList& output, const TokenizerOptions& options = TokenizerOptions());
+// Pull-based tokenizer over UTF-8 input, like TokenizeUTF8 but one token per call to Next.
+// Nothing past the last token asked for is tokenized, and no token is stored, so consumers that stop early
+// or process tokens as they come never pay for the whole input.
+class Tokenizer
+{
+public:
+	// The input has to outlive the tokenizer and the values of its tokens.
+	Tokenizer(const char* text, SizeType size, const TokenizerOptions& options = TokenizerOptions(),
+		MemoryResource* resource = std::pmr::get_default_resource());
+	// Consumes the next token. Once the input is exhausted, every call returns an <EOF-token>.
+	// Returns false on a parse error, or for input over MAX_INPUT_SIZE, after which Next should not be called anymore.
+	bool Next(Token& output);
+	// Starts over on new input. The memory used for the values of the previous tokens is kept for the next ones,
+	// which invalidates those values.
+	void Reset(const char* text, SizeType size);
+	// Where the values of the returned tokens are, they stay valid for the lifetime of the tokenizer.
+	// Its m_Tokens stays empty.
+	const TokenList& GetValues() const;
+private:
+	UTF8InputStream m_InputStream;
+	TokenList m_Values;
+	TokenizerOptions m_Options;
+	bool m_IsInputTooLarge;
+};
 }
\ No newline at end of file